@@ -0,0 +1,465 @@
+#pragma once
+#include "bitboard.h"
+#include "gridSize.h"
+#include "gridTables.h"
+#include "solver.h"
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <tuple>
+#include <vector>
+
+// The A* solver: its priority queue, its knowledge of the map and the
+// searches of safe paths on it. AStar.cpp plays the game with them, and
+// bench.cpp measures them
+namespace AStar
+{
+inline int ManhattanDistance(int x1, int y1, int x2, int y2)
+{
+    return abs(x1 - x2) + abs(y1 - y2);
+}
+
+// A node for the A* algorithm
+struct Node
+{
+    int x, y;             // The coordinates of the node
+    Node* back = nullptr; // Where we came from (optimally)
+    int dist;             // The optimal distance from the start
+    int heuristic; // The lower bound for the distance from here to the goal
+    Node() : Node(0, 0, 0, 0)
+    {
+    }
+    Node(int x, int y, int dist, int heuristic)
+        : x(x), y(y), dist(dist), heuristic(dist + heuristic)
+    {
+    }
+    inline int Estimate() const // How promising this node is
+    {
+        return dist + heuristic;
+    }
+};
+
+// A comparator that orders A* nodes by their Estimates (increasingly)
+struct NodeAStarOrder
+{
+    bool operator()(const Node& a, const Node& b) const
+    {
+        int ae = a.Estimate(), be = b.Estimate();
+        int ah = a.heuristic, bh = b.heuristic;
+        // Sort by:
+        // 1. The estimates
+        // 2. If equal - by distance to goal
+        // 3. If equal - arbitrarily
+        return std::tie(ae, ah, a.x, a.y) < std::tie(be, bh, b.x, b.y);
+    }
+};
+
+// Whether a NodeQueue with a bucket per key is small enough for the grid
+constexpr bool DenseQueue(int TopX, int TopY)
+{
+    long long cells = TopX * TopY, heuristics = TopX + TopY - 1;
+    return (cells + heuristics) * heuristics * ((cells + 63) / 64) <= 1 << 16;
+}
+
+// A priority queue of A* nodes on a TopX by TopY grid, in the order of
+// NodeAStarOrder. It never allocates: both the estimates and the heuristics
+// are small, so every (Estimate, heuristic) pair has its own bucket, and a
+// bucket is a bitmask of the cells in it, ordered by (x, y).
+// A node must be erased before its distance is changed.
+template <int TopX, int TopY, bool Dense = DenseQueue(TopX, TopY)>
+class NodeQueue
+{
+    static constexpr int Cells = TopX * TopY;
+    static constexpr int Words = (Cells + 63) / 64;
+    // Heuristics are below TopX + TopY - 1, estimates - below Cells + that
+    static constexpr int Heuristics = TopX + TopY - 1;
+    static constexpr int Keys = (Cells + Heuristics) * Heuristics;
+    static constexpr int KeyWords = (Keys + 63) / 64;
+
+    unsigned long long buckets[Keys][Words];
+    unsigned long long nonempty[KeyWords]; // Which buckets have nodes
+    int size = 0;
+
+    static int Key(const Node& nd)
+    {
+        return nd.Estimate() * Heuristics + nd.heuristic;
+    }
+
+public:
+    NodeQueue()
+    {
+        std::fill_n(&buckets[0][0], Keys * Words, 0ULL);
+        std::fill_n(nonempty, KeyWords, 0ULL);
+    }
+    // Remove all nodes
+    void Clear()
+    {
+        for (int i = 0; i < KeyWords; i++)
+            for (; nonempty[i]; nonempty[i] &= nonempty[i] - 1)
+                std::fill_n(buckets[i * 64 + __builtin_ctzll(nonempty[i])],
+                            Words, 0ULL);
+        size = 0;
+    }
+    bool Empty() const
+    {
+        return size == 0;
+    }
+    void Insert(const Node& nd)
+    {
+        Counters::Count(Counters::QueueInserts);
+        int key = Key(nd), cell = nd.x * TopY + nd.y;
+        buckets[key][cell / 64] |= 1ULL << (cell % 64);
+        nonempty[key / 64] |= 1ULL << (key % 64);
+        size++;
+    }
+    void Erase(const Node& nd)
+    {
+        Counters::Count(Counters::QueueErases);
+        int key = Key(nd), cell = nd.x * TopY + nd.y;
+        unsigned long long* bucket = buckets[key];
+        bucket[cell / 64] &= ~(1ULL << (cell % 64));
+        size--;
+        for (int i = 0; i < Words; i++)
+            if (bucket[i])
+                return;
+        nonempty[key / 64] &= ~(1ULL << (key % 64));
+    }
+    // The bucket with the best nodes. The queue must not be empty
+    int TopBucket() const
+    {
+        int i = 0;
+        while (!nonempty[i])
+            i++;
+        return i * 64 + __builtin_ctzll(nonempty[i]);
+    }
+    // The first cell x * TopY + y of the bucket that is not less than `from`,
+    // or -1 if there is none
+    int NextInBucket(int bucket, int from) const
+    {
+        for (int i = from / 64; i < Words; i++)
+        {
+            unsigned long long word = buckets[bucket][i];
+            if (i == from / 64)
+                word &= ~0ULL << (from % 64);
+            if (word)
+                return i * 64 + __builtin_ctzll(word);
+        }
+        return -1;
+    }
+    // The best node's cell x * TopY + y. The queue must not be empty
+    int Top() const
+    {
+        return NextInBucket(TopBucket(), 0);
+    }
+};
+
+// The same queue for large grids, where a bucket per key would not fit in
+// memory: the nodes are kept in a set, ordered by their keys and cells
+template <int TopX, int TopY> class NodeQueue<TopX, TopY, false>
+{
+    static constexpr int Heuristics = TopX + TopY - 1;
+    std::set<std::pair<int, int>> nodes; // (key, x * TopY + y)
+
+    static int Key(const Node& nd)
+    {
+        return nd.Estimate() * Heuristics + nd.heuristic;
+    }
+
+public:
+    void Clear()
+    {
+        nodes.clear();
+    }
+    bool Empty() const
+    {
+        return nodes.empty();
+    }
+    void Insert(const Node& nd)
+    {
+        Counters::Count(Counters::QueueInserts);
+        nodes.emplace(Key(nd), nd.x * TopY + nd.y);
+    }
+    void Erase(const Node& nd)
+    {
+        Counters::Count(Counters::QueueErases);
+        nodes.erase({Key(nd), nd.x * TopY + nd.y});
+    }
+    int TopBucket() const
+    {
+        return nodes.begin()->first;
+    }
+    int NextInBucket(int bucket, int from) const
+    {
+        auto it = nodes.lower_bound({bucket, from});
+        return it != nodes.end() && it->first == bucket ? it->second : -1;
+    }
+    int Top() const
+    {
+        return nodes.begin()->second;
+    }
+};
+
+// Bitmask that lists all objects in a cell
+enum class CellKind
+{
+    Unknown = 1,   // The cell has not been seen by Neo
+    Empty = 0,     // No objects
+    Perceived = 2, // The cell is perceived by an enemy
+    Agent = 4,     // An agent is here
+    Sentinel = 8,  // A sentinel is here
+    Keymaker = 16, // The keymaker is here
+                   // Ignore the Backdoor key since using it is optional
+};
+
+// Get the object representation from its mnemonic
+inline CellKind CellKindFromChar(char ch)
+{
+    switch (ch)
+    {
+    case 'P':
+        return CellKind::Perceived;
+    case 'A':
+        return CellKind::Agent;
+    case 'B':
+        return CellKind::Empty;
+    case 'S':
+        return CellKind::Sentinel;
+    case 'K':
+        return CellKind::Keymaker;
+    }
+    return CellKind::Empty; // Ignore the backdoor key
+}
+
+// Returns true iff Neo can move to the specified cell
+inline bool CellIsSafe(CellKind cell)
+{
+    return (static_cast<int>(cell) & ~(static_cast<int>(CellKind::Keymaker))) ==
+           0;
+}
+
+// What Neo knows about the environment on a W by H grid
+template <int W, int H> struct Map
+{
+    // The dimensions of the map
+    static constexpr int TopX = W, TopY = H;
+    // The list of 4 directions in which Neo can travel
+    static constexpr std::pair<int, int> Adjacent[4] = {
+        {1, 0},
+        {-1, 0},
+        {0, 1},
+        {0, -1},
+    };
+
+private:
+    using Cells = Bitboard<TopX, TopY>;
+    using Tables = GridTables<TopX, TopY>;
+    static constexpr const Tables& grid = gridTables<TopX, TopY>;
+    GridArray<CellKind, TopX, TopY> v;
+    Cells safe;                        // The cells known to be safe
+    int revision = 0;                  // Changes whenever the knowledge changes
+    NodeQueue<TopX, TopY> pq;          // Used by SafePath
+    GridArray<Node, TopX, TopY> nodes; // Used by SafePath
+    // The node of a cell belongs to the current search of SafePath only if
+    // its stamp is the search's, so the nodes are not reset for each search
+    GridArray<unsigned, TopX, TopY> stamps;
+    unsigned generation = 0;
+    // The node of (x, y) in the current search, unseen if it is new to it
+    Node& PathNode(int x, int y)
+    {
+        Node& nd = nodes[x][y];
+        if (stamps[x][y] != generation)
+        {
+            stamps[x][y] = generation;
+            nd.x = x;
+            nd.y = y;
+            nd.heuristic = nd.dist = -1;
+        }
+        return nd;
+    }
+    // The state of the search of SafeDistance: from (distx, disty), valid
+    // while the revision is distrevision. The search has reached the cells
+    // distreached, and distfrontier are the last of them, distlevel away
+    GridArray<int, TopX, TopY> dists;
+    Cells distreached, distfrontier;
+    int distlevel = 0;
+    int distx = -1, disty = -1, distrevision = -1;
+    Surroundings<TopX, TopY> surroundings; // Used by ReadSurroundings
+
+public:
+    // Forget everything
+    void ResetMap()
+    {
+        v.Fill(CellKind::Unknown);
+        safe = Cells();
+        revision++;
+    }
+    Map()
+    {
+        ResetMap();
+        stamps.Fill(0);
+    }
+    // Is the cell with these coordinates within the boundaries?
+    inline static bool ValidateCell(int x, int y)
+    {
+        return x >= 0 && x < TopX && y >= 0 && y < TopY;
+    }
+    // Find the shortest path from (x1, y1) to (x2, y2) through safe cells only
+    std::vector<std::pair<int, int>> SafePath(int x1, int y1, int x2, int y2);
+    // The length of the path found by SafePath, or -1 if there is none.
+    // A single search finds the distances from (x1, y1) to all cells, and
+    // they are reused until (x1, y1) or the knowledge changes
+    int SafeDistance(int x1, int y1, int x2, int y2);
+    // Assign the knowledge about (x, y) cell
+    void Set(int x, int y, CellKind cell)
+    {
+        if (ValidateCell(x, y) && v[x][y] != cell)
+        {
+            v[x][y] = cell;
+            safe.Assign(x, y, CellIsSafe(cell));
+            revision++;
+        }
+    }
+    // Remove all objects from cell (x, y), i.e. make it known and empty.
+    inline void ClearCell(int x, int y)
+    {
+        Set(x, y, CellKind::Empty);
+    }
+    // Add the given object(s) to the cell (x, y)
+    void Add(int x, int y, CellKind cell)
+    {
+        if (ValidateCell(x, y))
+            Set(x, y,
+                static_cast<CellKind>(static_cast<int>(v[x][y]) |
+                                      static_cast<int>(cell)));
+    }
+    // return the knowledge about cell (x, y)
+    inline CellKind Cell(int x, int y)
+    {
+        return v[x][y];
+    }
+    // Handle what Neo sees from (x, y)
+    void ReadSurroundings(int x, int y, int radius,
+                          const std::vector<Observation>& seen)
+    {
+        surroundings.Read(*this, x, y, radius, seen, CellKindFromChar);
+    }
+};
+
+// Find the shortest path from (x1, y1) to (x2, y2) through safe cells only
+// Uses A* algorithm
+template <int W, int H>
+std::vector<std::pair<int, int>> Map<W, H>::SafePath(int x1, int y1, int x2,
+                                                     int y2)
+{
+    using namespace std;
+    Counters::Count(Counters::SafePaths);
+    pq.Clear(); // The priority queue of nodes
+    // Initially, all cells are unknown: a new generation makes every node
+    // stale. The stamps only need resetting when the generations wrap around
+    if (++generation == 0)
+    {
+        stamps.Fill(0);
+        generation = 1;
+    }
+    // The first cell is known
+    int start = Tables::Cell(x1, y1), goal = Tables::Cell(x2, y2);
+    PathNode(x1, y1) = Node(x1, y1, 0, grid.Distance(start, goal));
+    pq.Insert(nodes[x1][y1]);
+    while (!pq.Empty())
+    {
+        // Pop the best node for expansion
+        int top = pq.Top();
+        Node cur = nodes[top / TopY][top % TopY];
+        int curx = cur.x;
+        int cury = cur.y;
+        // Is this the target?
+        if (curx == x2 && cury == y2)
+            break;
+        pq.Erase(cur);
+        Counters::Count(Counters::SafePathNodes);
+        int newdist = cur.dist + 1; // The distance to adjacent nodes
+        typename Tables::Neighbours adj = grid.Adjacent(top);
+        for (int i = 0; i < adj.count; i++)
+        {
+            // (x, y) is the adjacent node
+            int c = adj.cells[i];
+            int x = c / TopY;
+            int y = c % TopY;
+            // Skip if this is not the goal, but the cell is blocked
+            if (c != goal && !CellIsSafe(v[x][y]))
+                continue;
+            Node& cur = PathNode(x, y);
+            // If cur is an unseen-before cell, make it seen
+            if (cur.dist == -1)
+            {
+                cur.dist = newdist;
+                cur.heuristic = grid.Distance(c, goal);
+                cur.back = &nodes[curx][cury];
+                pq.Insert(cur);
+            }
+            // If cur has been seen, we update the distance if it got shorter
+            else if (cur.dist > newdist)
+            {
+                pq.Erase(cur);
+                cur.dist = newdist;
+                cur.back = &nodes[curx][cury];
+                pq.Insert(cur);
+            }
+        }
+    }
+    Node& fin = PathNode(x2, y2);
+    // If we could not reach the goal, there is no path
+    if (fin.dist == -1)
+        return {};
+    // Traverse the path backwards
+    vector<pair<int, int>> res;
+    Node* cur = &nodes[x2][y2];
+    while (cur->x != x1 || cur->y != y1)
+    {
+        res.emplace_back(cur->x, cur->y);
+        cur = cur->back;
+    }
+    // flip the path, since it is written backwards
+    reverse(res.begin(), res.end());
+    return res;
+}
+
+// Breadth-first search from (x1, y1) through safe cells, one whole frontier
+// at a time. Unsafe cells get their distances too, but are never left, just
+// as SafePath lets its goal be unsafe. The search only goes as far as
+// needed to reach (x2, y2), and the next call picks it up from there
+template <int W, int H>
+int Map<W, H>::SafeDistance(int x1, int y1, int x2, int y2)
+{
+    if (x1 != distx || y1 != disty || revision != distrevision)
+    {
+        dists.Fill(-1);
+        dists[x1][y1] = 0;
+        distreached = distfrontier = Cells::Cell(x1, y1);
+        distlevel = 0;
+        distx = x1;
+        disty = y1;
+        distrevision = revision;
+    }
+    while (dists[x2][y2] == -1 && !distfrontier.Empty())
+    {
+        // The start is always left, whatever it is
+        Cells leaving = distlevel ? distfrontier & safe : distfrontier;
+        distfrontier = leaving.Neighbours() & ~distreached;
+        distreached |= distfrontier;
+        distlevel++;
+        for (int c = distfrontier.First(); c != -1;
+             c = distfrontier.Next(c + 1))
+            dists[c / TopY][c % TopY] = distlevel;
+    }
+    return dists[x2][y2];
+}
+
+// Move to (newx, newy) and handle what is seen from there
+template <int TopX, int TopY>
+void MakeMoveAndRead(Environment& env, Map<TopX, TopY>& mp, int newx,
+                     int newy, int radius)
+{
+    mp.ReadSurroundings(newx, newy, radius, env.Move(newx, newy));
+}
+} // namespace AStar
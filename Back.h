@@ -0,0 +1,366 @@
+#pragma once
+#include "bitboard.h"
+#include "gridSize.h"
+#include "gridTables.h"
+#include "solver.h"
+#include <algorithm>
+#include <iostream>
+
+// The backtracking solver: its knowledge of the map, its transposition table
+// and its depth-first search. Back.cpp plays the game with them, and
+// bench.cpp measures them
+namespace Backtracking
+{
+inline int ManhattanDistance(int x1, int y1, int x2, int y2)
+{
+    return abs(x1 - x2) + abs(y1 - y2);
+}
+
+// Bitmask that lists all objects in a cell
+enum class CellKind
+{
+    Unknown = 1,   // The cell has not been seen by Neo
+    Empty = 0,     // No objects
+    Perceived = 2, // The cell is perceived by an enemy
+    Agent = 4,     // An agent is here
+    Sentinel = 8,  // A sentinel is here
+    Keymaker = 16, // The keymaker is here
+                   // Ignore the Backdoor key since using it is optional
+};
+
+// Get the object representation from its mnemonic
+inline CellKind CellKindFromChar(char ch)
+{
+    switch (ch)
+    {
+    case 'P':
+        return CellKind::Perceived;
+    case 'A':
+        return CellKind::Agent;
+    case 'B':
+        return CellKind::Empty;
+    case 'S':
+        return CellKind::Sentinel;
+    case 'K':
+        return CellKind::Keymaker;
+    }
+    return CellKind::Empty; // Ignore the backdoor key
+}
+
+// Returns true iff Neo can move to the specified cell
+inline bool CellIsSafe(CellKind cell)
+{
+    return (static_cast<int>(cell) & ~(static_cast<int>(CellKind::Keymaker))) ==
+           0;
+}
+
+// Random keys for the Zobrist hashing of Neo's knowledge: the hash of a map
+// is the XOR of Key(x, y, kind) over its cells, and the cell Neo stands on
+// adds Key(x, y, Neo). The keys come from a fixed splitmix64 sequence, which
+// large grids compute when needed instead of keeping a table
+template <int TopX, int TopY> struct ZobristKeys
+{
+    static constexpr int Kinds = 32; // All combinations of the CellKind bits
+    static constexpr int Neo = Kinds;
+    static constexpr bool Tabulated = TopX * TopY <= 256;
+    uint64_t keys[Tabulated ? TopX * TopY * (Kinds + 1) : 1];
+
+    // The n-th number of the sequence
+    static constexpr uint64_t Compute(int n)
+    {
+        uint64_t z = 0x9E3779B97F4A7C15ULL * (n + 2);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    constexpr uint64_t Nth(int n) const
+    {
+        if constexpr (Tabulated)
+            return keys[n];
+        else
+            return Compute(n);
+    }
+
+    constexpr ZobristKeys() : keys()
+    {
+        if (Tabulated)
+            for (int n = 0; n < TopX * TopY * (Kinds + 1); n++)
+                keys[n] = Compute(n);
+    }
+    constexpr uint64_t Key(int x, int y, CellKind kind) const
+    {
+        return Nth((x * TopY + y) * (Kinds + 1) + static_cast<int>(kind));
+    }
+    constexpr uint64_t Position(int x, int y) const
+    {
+        return Nth((x * TopY + y) * (Kinds + 1) + Neo);
+    }
+};
+
+// What Neo knows about the environment on a W by H grid
+template <int W, int H> struct Map
+{
+    // The dimensions of the map
+    static constexpr int TopX = W, TopY = H;
+    // The list of 4 directions in which Neo can travel
+    static constexpr std::pair<int, int> Adjacent[4] = {
+        {1, 0},
+        {-1, 0},
+        {0, 1},
+        {0, -1},
+    };
+
+private:
+    using Cells = Bitboard<TopX, TopY>;
+    static constexpr ZobristKeys<TopX, TopY> zobrist{};
+    GridArray<CellKind, TopX, TopY> v;
+    uint64_t hash; // The Zobrist hash of v
+    // The cells that are safe or unknown, i.e. might be on Neo's path
+    Cells passable;
+    int revision = 0; // Changes whenever the passable cells change
+    // The cells from which there might be a path to (reachx, reachy), as
+    // found by CanContinuePath while the revision was reachrevision
+    Cells reaching;
+    int reachx = -1, reachy = -1, reachrevision = -1;
+    Surroundings<TopX, TopY> surroundings; // Used by ReadSurroundings
+
+public:
+    // Forget everything
+    void ResetMap()
+    {
+        v.Fill(CellKind::Unknown);
+        hash = 0;
+        for (int x = 0; x < TopX; x++)
+            for (int y = 0; y < TopY; y++)
+                hash ^= zobrist.Key(x, y, CellKind::Unknown);
+        passable = Cells::Full();
+        revision++;
+    }
+    Map()
+    {
+        ResetMap();
+    }
+    // Is the cell with these coordinates within the boundaries?
+    inline static bool ValidateCell(int x, int y)
+    {
+        return x >= 0 && x < TopX && y >= 0 && y < TopY;
+    }
+    // Assign the knowledge about (x, y) cell
+    void Set(int x, int y, CellKind cell)
+    {
+        if (ValidateCell(x, y) && v[x][y] != cell)
+        {
+            hash ^= zobrist.Key(x, y, v[x][y]) ^ zobrist.Key(x, y, cell);
+            v[x][y] = cell;
+            bool pass = CellIsSafe(cell) || cell == CellKind::Unknown;
+            if (passable.Test(x, y) != pass)
+            {
+                passable.Assign(x, y, pass);
+                revision++;
+            }
+        }
+    }
+    // Remove all objects from cell (x, y), i.e. make it known and empty.
+    inline void ClearCell(int x, int y)
+    {
+        Set(x, y, CellKind::Empty);
+    }
+    // Add the given object(s) to the cell (x, y)
+    void Add(int x, int y, CellKind cell)
+    {
+        if (ValidateCell(x, y))
+            Set(x, y,
+                static_cast<CellKind>(static_cast<int>(v[x][y]) |
+                                      static_cast<int>(cell)));
+    }
+    // return the knowledge about cell (x, y)
+    inline CellKind Cell(int x, int y)
+    {
+        return v[x][y];
+    }
+    // Handle what Neo sees from (x, y)
+    void ReadSurroundings(int x, int y, int radius,
+                          const std::vector<Observation>& seen)
+    {
+        surroundings.Read(*this, x, y, radius, seen, CellKindFromChar);
+    }
+    // Identifies what Neo knows and where Neo stands, up to hash collisions
+    uint64_t Hash(int x, int y) const
+    {
+        return hash ^ zobrist.Position(x, y);
+    }
+    // Heuristic: if the path travelled so far is marked with CellKind::Visited,
+    // can (x, y) be its continuation if we cannot cross our own path?
+    // Returns true if there might be a way to the target from (x, y)
+    bool CanContinuePath(int x, int y, int destx, int desty)
+    {
+        Counters::Count(Counters::CanContinue);
+        // The path may go through passable cells only, but its last step may
+        // lead anywhere. So it can start from the passable cells connected
+        // to the target or to its neighbours. Those are only searched for
+        // again when the knowledge changes
+        if (destx != reachx || desty != reachy || revision != reachrevision)
+        {
+            Cells last = Cells::Cell(destx, desty);
+            Cells seeds = (last | last.Neighbours()) & passable;
+            reaching = seeds.FloodFill(passable);
+            reachx = destx;
+            reachy = desty;
+            reachrevision = revision;
+        }
+        return (x == destx && y == desty) || reaching.Test(x, y);
+    }
+};
+
+// Move to (newx, newy) and handle what is seen from there
+template <int TopX, int TopY>
+void MakeMoveAndRead(Environment& env, Map<TopX, TopY>& mp, int newx,
+                     int newy, int radius)
+{
+    mp.ReadSurroundings(newx, newy, radius, env.Move(newx, newy));
+}
+
+// Remembers the searches started during a game: with what knowledge, from
+// which cell and at which distance from the origin. Entering a cell again
+// with the same knowledge and no closer to the origin cannot lead to a
+// shorter path, so that subtree can be skipped. The table is direct-mapped
+// and a new entry replaces an old one; the entries of the previous games are
+// told apart by their game number, so nothing is cleared between games
+class TranspositionTable
+{
+    static constexpr int Size = 1 << 14;
+    struct Entry
+    {
+        uint64_t key;
+        int dist, game;
+    };
+    Entry entries[Size]{};
+    int game = 0;
+
+public:
+    TableStats stats{};
+
+    void NewGame()
+    {
+        game++;
+    }
+    // Returns true if the state with this key has been searched from dist or
+    // closer this game, otherwise records that it is searched from dist
+    bool Visited(uint64_t key, int dist)
+    {
+        stats.probes++;
+        Entry& e = entries[key & (Size - 1)];
+        if (e.game == game && e.key == key && e.dist <= dist)
+        {
+            stats.hits++;
+            return true;
+        }
+        e = {key, dist, game};
+        return false;
+    }
+};
+
+// The state of the Depth-First Search algorithm on a TopX by TopY grid
+template <int TopX, int TopY> struct Search
+{
+    using Tables = GridTables<TopX, TopY>;
+    static constexpr const Tables& grid = gridTables<TopX, TopY>;
+
+    // A cell on the current path of the search
+    struct Frame
+    {
+        int x, y, dist;
+        typename Tables::Neighbours adj; // In the order to try them
+        int next;                        // The index of the next one to try
+    };
+
+    int targetx, targety;
+    // dists[x][y] = the minimal distance from origin to point (x, y) so far
+    GridArray<int, TopX, TopY> dists;
+    // The path never crosses itself, so it has at most one frame per cell
+    GridArray<Frame, TopX, TopY> frames;
+
+    // Search for the shortest path to the target from the origin, walking
+    // the paths with Neo. The table has the states searched this game
+    void DFS(Environment& env, Map<TopX, TopY>& mp, TranspositionTable& table,
+             int visionRadius, int& answer);
+};
+
+template <int TopX, int TopY>
+void Search<TopX, TopY>::DFS(Environment& env, Map<TopX, TopY>& mp,
+                             TranspositionTable& table, int visionRadius,
+                             int& answer)
+{
+    Frame* path = frames[0];
+    int target = Tables::Cell(targetx, targety);
+    // targetx + targety is the absolute minimum distance, cannot improve it
+    const int best = grid.Distance(0, target);
+    int top = 0;
+    // HEURISTIC:
+    // try the neighbours closest to the target first
+    path[0] = {0, 0, 0, grid.Towards(0, target), 0};
+    dists[0][0] = 0;
+    Counters::Count(Counters::Expanded);
+    while (top >= 0)
+    {
+        Frame& f = path[top];
+        if (f.next < f.adj.count)
+        {
+            // An adjacent cell is (nx, ny)
+            int nx = f.adj.cells[f.next] / TopY;
+            int ny = f.adj.cells[f.next] % TopY;
+            f.next++;
+            if (nx == targetx && ny == targety)
+            {
+                // We are one step away from the target
+                answer = std::min(answer, f.dist + 1);
+                f.next = f.adj.count;
+            }
+            // Skip if we cannot go to (nx, ny) or there was a better
+            // (shorter) way to get to (nx, ny)
+            else if (!CellIsSafe(mp.Cell(nx, ny)) ||
+                     (dists[nx][ny] < f.dist + 1 && dists[nx][ny] != -1))
+                continue;
+            // HEURISTIC:
+            // We also skip if moving to (nx, ny) guarantees a dead-end
+            else if (!mp.CanContinuePath(nx, ny, targetx, targety))
+                continue;
+            // Skip if the same search has already been made
+            else if (table.Visited(mp.Hash(nx, ny), f.dist + 1))
+                continue;
+            else
+            {
+                // Move there and explore, unless it cannot give a better
+                // answer
+                MakeMoveAndRead(env, mp, nx, ny, visionRadius);
+                if (f.dist + 1 < answer)
+                {
+                    dists[nx][ny] = f.dist + 1;
+                    path[++top] = {
+                        nx, ny, f.dist + 1,
+                        grid.Towards(Tables::Cell(nx, ny), target), 0};
+                    Counters::Count(Counters::Expanded);
+                    Counters::Max(Counters::MaxDepth, top);
+                }
+                else
+                {
+                    Counters::Count(Counters::Backtracks);
+                    MakeMoveAndRead(env, mp, f.x, f.y, visionRadius);
+                }
+                continue;
+            }
+        }
+        // Done with the cell on top: go back to the previous one, unless
+        // nothing better can be found
+        top--;
+        if (top < 0 || answer == best)
+            return;
+        Counters::Count(Counters::Backtracks);
+        MakeMoveAndRead(env, mp, path[top].x, path[top].y, visionRadius);
+    }
+}
+
+// Greater than any answer: a shortest path never visits a cell twice, so it
+// has fewer steps than the grid has cells
+template <int TopX, int TopY> constexpr int NoAnswer = TopX * TopY;
+} // namespace Backtracking
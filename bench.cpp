@@ -0,0 +1,617 @@
+// Microbenchmarks of the map's and the solvers' search kernels on the 9 by 9
+// maps of a corpus. The kernels come from the solvers' headers, and the
+// solvers are linked in, built with SOLVER_LIBRARY defined
+#include "AStar.h"
+#include "Back.h"
+#include "interactorMap.h"
+#include "reporting.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <new>
+#include <regex>
+#include <sched.h>
+#include <set>
+#include <sstream>
+using namespace std;
+
+// The number of allocations made so far
+long long allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* p = malloc(size))
+        return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace AStar
+{
+// Map<9, 9>::SafePath as it was with std::set as the priority queue, kept for
+// comparison
+vector<pair<int, int>> SetSafePath(Map<9, 9>& mp, int x1, int y1, int x2,
+                                   int y2)
+{
+    set<Node, NodeAStarOrder> pq;
+    Node nodes[Map<9, 9>::TopX][Map<9, 9>::TopY];
+    for (int i = 0; i < Map<9, 9>::TopX; i++)
+        for (int j = 0; j < Map<9, 9>::TopY; j++)
+        {
+            Node& nd = nodes[i][j];
+            nd.x = i;
+            nd.y = j;
+            nd.heuristic = nd.dist = -1;
+        }
+    nodes[x1][y1] = Node(x1, y1, 0, ManhattanDistance(x1, y1, x2, y2));
+    pq.insert(nodes[x1][y1]);
+    while (pq.size())
+    {
+        auto begin = pq.begin();
+        Node cur = *begin;
+        int curx = cur.x;
+        int cury = cur.y;
+        if (curx == x2 && cury == y2)
+            break;
+        pq.erase(begin);
+        int newdist = cur.dist + 1;
+        for (auto d : Map<9, 9>::Adjacent)
+        {
+            int x = curx + d.first;
+            int y = cury + d.second;
+            if (!(x == x2 && y == y2) &&
+                !(Map<9, 9>::ValidateCell(x, y) && CellIsSafe(mp.Cell(x, y))))
+                continue;
+            Node& cur = nodes[x][y];
+            if (cur.dist == -1)
+            {
+                cur.dist = newdist;
+                cur.heuristic = ManhattanDistance(x, y, x2, y2);
+                cur.back = &nodes[curx][cury];
+                pq.insert(cur);
+            }
+            else if (cur.dist > newdist)
+            {
+                pq.erase(cur);
+                cur.dist = newdist;
+                cur.back = &nodes[curx][cury];
+                pq.insert(cur);
+            }
+        }
+    }
+    if (nodes[x2][y2].dist == -1)
+        return {};
+    vector<pair<int, int>> res;
+    Node* cur = &nodes[x2][y2];
+    while (cur->x != x1 || cur->y != y1)
+    {
+        res.emplace_back(cur->x, cur->y);
+        cur = cur->back;
+    }
+    reverse(res.begin(), res.end());
+    return res;
+}
+} // namespace AStar
+
+namespace Backtracking
+{
+// DFS as it was with recursion and a sorted vector of neighbours per call,
+// kept for comparison
+template <int TopX, int TopY>
+void RecursiveDFS(Environment& env, Map<TopX, TopY>& mp,
+                  Search<TopX, TopY>& search, TranspositionTable& table, int x,
+                  int y, int dist, int visionRadius, int& answer)
+{
+    using SolverMap = Map<TopX, TopY>;
+    auto& dists = search.dists;
+    int targetx = search.targetx, targety = search.targety;
+    if (dist >= answer)
+        return;
+    dists[x][y] = dist;
+    vector<pair<int, int>> adj(SolverMap::Adjacent, SolverMap::Adjacent + 4);
+    for (auto& p : adj)
+    {
+        p.first += x;
+        p.second += y;
+    }
+    sort(adj.begin(), adj.end(),
+         [&](const pair<int, int>& a, const pair<int, int>& b) {
+             return ManhattanDistance(a.first, a.second, targetx, targety) <
+                    ManhattanDistance(b.first, b.second, targetx, targety);
+         });
+    for (auto& p : adj)
+    {
+        int nx = p.first;
+        int ny = p.second;
+        if (nx == targetx && ny == targety)
+        {
+            answer = min(answer, dist + 1);
+            return;
+        }
+        if (!SolverMap::ValidateCell(nx, ny) || !CellIsSafe(mp.Cell(nx, ny)) ||
+            (dists[nx][ny] < dist + 1 && dists[nx][ny] != -1))
+            continue;
+        if (!mp.CanContinuePath(nx, ny, targetx, targety))
+            continue;
+        if (table.Visited(mp.Hash(nx, ny), dist + 1))
+            continue;
+        MakeMoveAndRead(env, mp, nx, ny, visionRadius);
+        RecursiveDFS(env, mp, search, table, nx, ny, dist + 1, visionRadius,
+                     answer);
+        if (answer == ManhattanDistance(0, 0, targetx, targety))
+            return;
+        MakeMoveAndRead(env, mp, x, y, visionRadius);
+    }
+}
+
+// Play the game on a TopX by TopY grid with RecursiveDFS
+template <int TopX, int TopY>
+int RecursiveSolveGrid(Environment& env, TranspositionTable& table,
+                       int variant, int targetx, int targety)
+{
+    Search<TopX, TopY> search;
+    search.targetx = targetx;
+    search.targety = targety;
+    Map<TopX, TopY> mp;
+    search.dists.Fill(-1);
+    table.NewGame();
+    MakeMoveAndRead(env, mp, 0, 0, variant);
+    int res = NoAnswer<TopX, TopY>;
+    RecursiveDFS(env, mp, search, table, 0, 0, 0, variant, res);
+    if (res == NoAnswer<TopX, TopY>)
+        res = -1;
+    env.Answer(res);
+    return res;
+}
+
+// Solve with RecursiveDFS
+int RecursiveSolve(Environment& env, TranspositionTable& table)
+{
+    int variant, width, height, targetx, targety;
+    env.Start(variant, width, height, targetx, targety);
+    int res = -1;
+    if (!WithGridSize(width, height, [&](auto size) {
+            using Size = decltype(size);
+            res = RecursiveSolveGrid<Size::Width, Size::Height>(
+                env, table, variant, targetx, targety);
+        }))
+        env.Answer(res);
+    return res;
+}
+} // namespace Backtracking
+
+// Plays a game with the observations from every cell computed in advance, so
+// that a move costs next to nothing and allocates nothing
+class OracleEnvironment : public Environment
+{
+    int radius, width, height;
+    pair<int, int> target;
+    vector<vector<Observation>> seen; // seen[x * height + y]
+
+public:
+    // A hash of the moves made so far
+    uint64_t trace = 0;
+
+    OracleEnvironment(const ::Map& mp, int radius)
+        : radius(radius), width(mp.Width()), height(mp.Height()),
+          target(mp.KeymakerCoords()), seen(width * height)
+    {
+        for (int x = 0; x < width; x++)
+            for (int y = 0; y < height; y++)
+                for (auto& p : mp.Vision(x, y, radius))
+                    seen[x * height + y].push_back(
+                        {p.first.first, p.first.second, p.second});
+    }
+    void Start(int& variant, int& width, int& height, int& targetx,
+               int& targety) override
+    {
+        variant = radius;
+        width = this->width;
+        height = this->height;
+        targetx = target.first;
+        targety = target.second;
+    }
+    const vector<Observation>& Move(int x, int y) override
+    {
+        trace = trace * 0x100000001B3ULL + x * height + y + 1;
+        return seen[x * height + y];
+    }
+    void Answer(int dist) override
+    {
+        trace = trace * 0x100000001B3ULL + dist;
+    }
+};
+
+// What a solver would know about the map if it had seen everything
+template <class SolverMap, class FromChar>
+SolverMap FullKnowledge(const ::Map& mp, FromChar fromchar)
+{
+    SolverMap res;
+    for (int x = 0; x < 9; x++)
+        for (int y = 0; y < 9; y++)
+        {
+            res.ClearCell(x, y);
+            for (int ck = (int)mp.Cell(x, y); ck; ck &= ck - 1)
+                res.Add(x, y, fromchar(KindToChar((CellKind)(ck & -ck))));
+        }
+    return res;
+}
+
+// The text of the map, as Map::Read reads it
+string MapText(const ::Map& mp)
+{
+    string res;
+    if (mp.Width() != 9 || mp.Height() != 9)
+        res = "size " + to_string(mp.Width()) + ' ' + to_string(mp.Height());
+    for (int y = 0; y < mp.Height(); y++)
+    {
+        res += '\n';
+        for (int x = 0; x < mp.Width(); x++)
+        {
+            int ck = (int)mp.Cell(x, y);
+            char c = '.';
+            for (auto kind : {CellKind::Agent, CellKind::Sentinel,
+                              CellKind::Key, CellKind::Keymaker})
+                if (ck & (int)kind)
+                    c = kind == CellKind::Key ? 'B' : KindToChar(kind);
+            res += c;
+        }
+    }
+    return res + '\n';
+}
+
+// A SafePath query: from (x1, y1) to (x2, y2)
+struct PathQuery
+{
+    AStar::Map<9, 9>* mp;
+    int x1, y1, x2, y2;
+};
+
+// A kernel run on every input of the corpus
+struct Benchmark
+{
+    string name;
+    long long ops; // The number of operations in a pass
+    // Run the kernel once on every input, return a checksum of the results
+    function<uint64_t()> pass;
+    // A running count of something done by the kernel, reported per
+    // operation, or nullptr
+    function<long long()> counter = nullptr;
+    string countername = "";
+};
+
+// The benchmarks, in the order they run
+vector<Benchmark> benchmarks;
+
+void Register(const string& name, long long ops, function<uint64_t()> pass,
+              function<long long()> counter = nullptr,
+              const string& countername = "")
+{
+    benchmarks.push_back({name, ops, pass, counter, countername});
+}
+
+// How the benchmarks are run
+struct BenchSetup
+{
+    double warmup = 0.1;  // Seconds of passes before measuring
+    double mintime = 0.2; // Seconds of passes in a repetition, at least
+    int repetitions = 5;
+};
+
+// The measurements of a repetition, per operation
+struct Measurement
+{
+    double wallns, cpuns, allocs, count;
+};
+
+double CpuSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Run whole passes for at least the given time
+Measurement Measure(const Benchmark& bench, double seconds)
+{
+    uint64_t checksum = 0;
+    long long passes = 0, allocsbefore = allocations;
+    long long countbefore = bench.counter ? bench.counter() : 0;
+    double cpustart = CpuSeconds();
+    auto start = chrono::steady_clock::now();
+    double elapsed;
+    do
+    {
+        checksum += bench.pass();
+        passes++;
+        elapsed =
+            chrono::duration<double>(chrono::steady_clock::now() - start)
+                .count();
+    } while (elapsed < seconds);
+    double cpu = CpuSeconds() - cpustart;
+    // Keep the compiler from throwing the work away
+    if (checksum == 1)
+        cout << "";
+    double ops = (double)passes * bench.ops;
+    long long count = bench.counter ? bench.counter() - countbefore : 0;
+    return {elapsed * 1e9 / ops, cpu * 1e9 / ops,
+            (allocations - allocsbefore) / ops, count / ops};
+}
+
+// Warm the caches and the branch predictors up, measure the repetitions and
+// print the medians, and the spread of the wall-clock times
+void Run(const Benchmark& bench, const BenchSetup& setup)
+{
+    Measure(bench, setup.warmup);
+    vector<Measurement> reps;
+    for (int i = 0; i < setup.repetitions; i++)
+        reps.push_back(Measure(bench, setup.mintime));
+    auto median = [&](double Measurement::*field) {
+        vector<double> vals;
+        for (auto& m : reps)
+            vals.push_back(m.*field);
+        sort(vals.begin(), vals.end());
+        int n = vals.size();
+        return (vals[(n - 1) / 2] + vals[n / 2]) / 2;
+    };
+    double mean = 0, variance = 0;
+    for (auto& m : reps)
+        mean += m.wallns / reps.size();
+    for (auto& m : reps)
+        variance += (m.wallns - mean) * (m.wallns - mean) / reps.size();
+    printf("%-44s %10.1f %10.1f %6.1f%% %9.2f %9lld", bench.name.c_str(),
+           median(&Measurement::wallns), median(&Measurement::cpuns),
+           100 * sqrt(variance) / mean, median(&Measurement::allocs),
+           bench.ops);
+    if (bench.counter)
+        printf(" %s/op=%.1f", bench.countername.c_str(),
+               median(&Measurement::count));
+    printf("\n");
+    fflush(stdout);
+}
+
+// Run the process on a single CPU, so that it is not moved between CPUs
+// while measuring. Returns the CPU, or -1 if that fails
+int PinToCpu(int cpu)
+{
+    if (cpu < 0)
+        cpu = sched_getcpu();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return cpu >= 0 && sched_setaffinity(0, sizeof(set), &set) == 0 ? cpu
+                                                                    : -1;
+}
+
+// Run the benchmarks given on the command line
+int Run(int argc, char** argv)
+{
+    BenchSetup setup;
+    string filter;
+    int cpu = -1;
+    int argsstart = 1;
+    for (; argsstart < argc && argv[argsstart][0] == '-'; argsstart++)
+    {
+        if (strcmp(argv[argsstart], "-filter") == 0 && argsstart + 1 < argc)
+            filter = argv[++argsstart];
+        else if (strcmp(argv[argsstart], "-repetitions") == 0 &&
+                 argsstart + 1 < argc)
+            setup.repetitions = max(1, atoi(argv[++argsstart]));
+        else if (strcmp(argv[argsstart], "-mintime") == 0 &&
+                 argsstart + 1 < argc)
+            setup.mintime = atof(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-warmup") == 0 &&
+                 argsstart + 1 < argc)
+            setup.warmup = atof(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-cpu") == 0 && argsstart + 1 < argc)
+            cpu = atoi(argv[++argsstart]);
+    }
+    if (argc - argsstart != 1)
+    {
+        cout << "Usage: bench [-filter REGEX] [-repetitions N] [-mintime S] "
+             << "[-warmup S] [-cpu C] path/of/tests\n"
+             << "Runs the microbenchmarks whose names match the regular "
+             << "expression on the 9 by 9 tests, pinned to the CPU C (by "
+             << "default the current one). Each benchmark is warmed up for S "
+             << "seconds (0.1 by default), then measured N times (5) for at "
+             << "least S seconds (0.2)" << endl;
+        return 0;
+    }
+    // Pin first, so that the data is allocated near the CPU
+    cpu = PinToCpu(cpu);
+    if (cpu == -1)
+        cout << "Could not pin the process to a CPU" << endl;
+
+    vector<unique_ptr<::Map>> maps;
+    vector<string> texts;
+    Corpus corpus(argv[argsstart]);
+    for (size_t i = 0; i < corpus.Size(); i++)
+    {
+        auto mp = corpus.Load(i);
+        if (mp->Width() != 9 || mp->Height() != 9)
+            continue;
+        texts.push_back(MapText(*mp));
+        maps.push_back(move(mp));
+    }
+    if (maps.empty())
+    {
+        cout << "There are no 9 by 9 tests" << endl;
+        return 1;
+    }
+    for (size_t i = 0; i < maps.size(); i++)
+    {
+        istringstream in(texts[i]);
+        if (Map::Read(in)->Hash() != maps[i]->Hash())
+        {
+            cout << "The text of map " << i << " reads differently" << endl;
+            return 1;
+        }
+    }
+    vector<AStar::Map<9, 9>> astarmaps;
+    vector<Backtracking::Map<9, 9>> backmaps;
+    for (auto& mp : maps)
+    {
+        astarmaps.push_back(FullKnowledge<AStar::Map<9, 9>>(
+            *mp, AStar::CellKindFromChar));
+        backmaps.push_back(FullKnowledge<Backtracking::Map<9, 9>>(
+            *mp, Backtracking::CellKindFromChar));
+    }
+    // From every safe cell to the Keymaker
+    vector<PathQuery> queries;
+    for (size_t i = 0; i < maps.size(); i++)
+    {
+        auto [tx, ty] = maps[i]->KeymakerCoords();
+        for (int x = 0; x < 9; x++)
+            for (int y = 0; y < 9; y++)
+                if (maps[i]->CellIsSafe(x, y))
+                    queries.push_back({&astarmaps[i], x, y, tx, ty});
+    }
+    for (auto& q : queries)
+        if (q.mp->SafePath(q.x1, q.y1, q.x2, q.y2) !=
+            AStar::SetSafePath(*q.mp, q.x1, q.y1, q.x2, q.y2))
+        {
+            cout << "The queues disagree on the path from (" << q.x1 << ", "
+                 << q.y1 << ") to (" << q.x2 << ", " << q.y2 << ")" << endl;
+            return 1;
+        }
+    // The games, with the observations computed in advance. Each search
+    // keeps a transposition table of its own
+    vector<OracleEnvironment> games[2];
+    Backtracking::Player player;
+    auto recursivetable = make_unique<Backtracking::TranspositionTable>();
+    for (int variant = 1; variant <= 2; variant++)
+        for (size_t i = 0; i < maps.size(); i++)
+        {
+            OracleEnvironment recursive(*maps[i], variant);
+            games[variant - 1].push_back(recursive);
+            Backtracking::RecursiveSolve(recursive, *recursivetable);
+            player.Solve(games[variant - 1].back());
+            if (recursive.trace != games[variant - 1].back().trace)
+            {
+                cout << "The searches disagree on map " << i << ", variant "
+                     << variant << endl;
+                return 1;
+            }
+        }
+
+    long long nmaps = maps.size(), nqueries = queries.size();
+    Register("Map::Read", nmaps, [&]() {
+        uint64_t res = 0;
+        for (auto& text : texts)
+        {
+            istringstream in(text);
+            res += Map::Read(in)->KeymakerCoords().first;
+        }
+        return res;
+    });
+    Register("Map::Parse", nmaps, [&]() {
+        uint64_t res = 0;
+        for (auto& text : texts)
+        {
+            string_view view = text;
+            res += Map::Parse(view)->KeymakerCoords().first;
+        }
+        return res;
+    });
+    Register("Map::Solution", nmaps, [&]() {
+        uint64_t res = 0;
+        for (auto& mp : maps)
+            res += mp->Solution();
+        return res;
+    });
+    for (int radius = 1; radius <= 2; radius++)
+        Register("Map::Vision/radius:" + to_string(radius), nmaps * 81,
+                 [&, radius]() {
+                     uint64_t res = 0;
+                     for (auto& mp : maps)
+                         for (int x = 0; x < 9; x++)
+                             for (int y = 0; y < 9; y++)
+                                 res += mp->Vision(x, y, radius).size();
+                     return res;
+                 });
+    Register("AStar::Map::SafePath", nqueries, [&]() {
+        uint64_t res = 0;
+        for (auto& q : queries)
+            res += q.mp->SafePath(q.x1, q.y1, q.x2, q.y2).size();
+        return res;
+    });
+    // The queue as it was, kept for comparison
+    Register("AStar::SetSafePath", nqueries, [&]() {
+        uint64_t res = 0;
+        for (auto& q : queries)
+            res += AStar::SetSafePath(*q.mp, q.x1, q.y1, q.x2, q.y2).size();
+        return res;
+    });
+    // With the same target, CanContinuePath keeps the cells found; with the
+    // targets alternating, it searches for them on every call
+    for (bool alternate : {false, true})
+        Register(string("Backtracking::Map::CanContinuePath/") +
+                     (alternate ? "uncached" : "cached"),
+                 nqueries, [&, alternate]() {
+                     uint64_t res = 0;
+                     for (size_t i = 0; i < queries.size(); i++)
+                     {
+                         auto& q = queries[i];
+                         auto& mp = backmaps[q.mp - astarmaps.data()];
+                         bool origin = alternate && i % 2;
+                         res += mp.CanContinuePath(q.x1, q.y1,
+                                                   origin ? 0 : q.x2,
+                                                   origin ? 0 : q.y2);
+                     }
+                     return res;
+                 });
+    // The states that the search did not find in the transposition table
+    auto misses = [](Backtracking::TableStats stats) {
+        return stats.probes - stats.hits;
+    };
+    for (int variant = 1; variant <= 2; variant++)
+        for (bool recursive : {false, true})
+            Register(
+                string("Backtracking::DFS/") +
+                    (recursive ? "recursive" : "iterative") +
+                    "/variant:" + to_string(variant),
+                nmaps,
+                [&, variant, recursive]() {
+                    uint64_t res = 0;
+                    for (auto& env : games[variant - 1])
+                        res += recursive ? Backtracking::RecursiveSolve(
+                                               env, *recursivetable)
+                                         : player.Solve(env);
+                    return res;
+                },
+                [&, recursive]() {
+                    return misses(recursive ? recursivetable->stats
+                                            : player.Stats());
+                },
+                "misses");
+
+    cout << "Running " << argv[argsstart] << ": " << nmaps << " maps, "
+         << nqueries << " paths";
+    if (cpu != -1)
+        cout << ", on CPU " << cpu;
+    cout << "\n";
+    printf("%-44s %10s %10s %7s %9s %9s\n", "Benchmark", "Time ns/op",
+           "CPU ns/op", "CV", "Allocs/op", "Ops/pass");
+    regex pattern(filter);
+    for (auto& bench : benchmarks)
+        if (regex_search(bench.name, pattern))
+            Run(bench, setup);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
+}
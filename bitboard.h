@@ -0,0 +1,258 @@
+#pragma once
+#include <cstdint>
+
+// A set of cells of a W by H grid, one bit per cell. The cell (x, y) is the
+// bit x * H + y, so a step along x shifts the bits by H and a step along y
+// shifts them by 1. Set operations, perception zones and the expansion of a
+// search frontier to the adjacent cells take a few word operations each.
+template <int W, int H> class Bitboard
+{
+public:
+    static constexpr int Cells = W * H;
+    static constexpr int Words = (Cells + 63) / 64;
+
+private:
+    uint64_t w[Words]{};
+
+    // Clear the bits beyond the last cell
+    constexpr Bitboard& Trim()
+    {
+        if (Cells % 64)
+            w[Words - 1] &= ~0ULL >> (64 - Cells % 64);
+        return *this;
+    }
+    // Move every bit n positions up, the bits shifted out are lost
+    constexpr Bitboard ShiftUp(int n) const
+    {
+        Bitboard res;
+        int words = n / 64, bits = n % 64;
+        for (int i = Words - 1; i >= words; i--)
+        {
+            res.w[i] = w[i - words] << bits;
+            if (bits && i - words > 0)
+                res.w[i] |= w[i - words - 1] >> (64 - bits);
+        }
+        return res.Trim();
+    }
+    // Move every bit n positions down, the bits shifted out are lost
+    constexpr Bitboard ShiftDown(int n) const
+    {
+        Bitboard res;
+        int words = n / 64, bits = n % 64;
+        for (int i = 0; i + words < Words; i++)
+        {
+            res.w[i] = w[i + words] >> bits;
+            if (bits && i + words + 1 < Words)
+                res.w[i] |= w[i + words + 1] << (64 - bits);
+        }
+        return res;
+    }
+    // The cells from..to (inclusive)
+    static constexpr Bitboard Range(int from, int to)
+    {
+        Bitboard res;
+        for (int i = from; i <= to; i++)
+            res.Set(i);
+        return res;
+    }
+    // The cells with the given y
+    static constexpr Bitboard Row(int y)
+    {
+        Bitboard res;
+        for (int x = 0; x < W; x++)
+            res.Set(x, y);
+        return res;
+    }
+
+public:
+    constexpr Bitboard() = default;
+
+    static constexpr bool Valid(int x, int y)
+    {
+        return x >= 0 && x < W && y >= 0 && y < H;
+    }
+    static constexpr int Index(int x, int y)
+    {
+        return x * H + y;
+    }
+    constexpr bool Test(int index) const
+    {
+        return w[index / 64] >> (index % 64) & 1;
+    }
+    constexpr bool Test(int x, int y) const
+    {
+        return Test(Index(x, y));
+    }
+    constexpr void Set(int index)
+    {
+        w[index / 64] |= 1ULL << (index % 64);
+    }
+    constexpr void Set(int x, int y)
+    {
+        Set(Index(x, y));
+    }
+    constexpr void Reset(int index)
+    {
+        w[index / 64] &= ~(1ULL << (index % 64));
+    }
+    constexpr void Reset(int x, int y)
+    {
+        Reset(Index(x, y));
+    }
+    constexpr void Assign(int x, int y, bool value)
+    {
+        if (value)
+            Set(x, y);
+        else
+            Reset(x, y);
+    }
+
+    constexpr bool Empty() const
+    {
+        for (int i = 0; i < Words; i++)
+            if (w[i])
+                return false;
+        return true;
+    }
+    constexpr int Count() const
+    {
+        int res = 0;
+        for (int i = 0; i < Words; i++)
+            res += __builtin_popcountll(w[i]);
+        return res;
+    }
+    // The first cell not less than `from`, or -1 if there is none.
+    // Iterate with `for (c = b.First(); c != -1; c = b.Next(c + 1))`
+    constexpr int Next(int from) const
+    {
+        for (int i = from / 64; i < Words; i++)
+        {
+            uint64_t word = w[i];
+            if (i == from / 64)
+                word &= ~0ULL << (from % 64);
+            if (word)
+                return i * 64 + __builtin_ctzll(word);
+        }
+        return -1;
+    }
+    constexpr int First() const
+    {
+        return Next(0);
+    }
+
+    constexpr Bitboard& operator|=(const Bitboard& b)
+    {
+        for (int i = 0; i < Words; i++)
+            w[i] |= b.w[i];
+        return *this;
+    }
+    constexpr Bitboard& operator&=(const Bitboard& b)
+    {
+        for (int i = 0; i < Words; i++)
+            w[i] &= b.w[i];
+        return *this;
+    }
+    constexpr Bitboard& operator^=(const Bitboard& b)
+    {
+        for (int i = 0; i < Words; i++)
+            w[i] ^= b.w[i];
+        return *this;
+    }
+    constexpr Bitboard operator|(const Bitboard& b) const
+    {
+        return Bitboard(*this) |= b;
+    }
+    constexpr Bitboard operator&(const Bitboard& b) const
+    {
+        return Bitboard(*this) &= b;
+    }
+    constexpr Bitboard operator^(const Bitboard& b) const
+    {
+        return Bitboard(*this) ^= b;
+    }
+    constexpr Bitboard operator~() const
+    {
+        Bitboard res;
+        for (int i = 0; i < Words; i++)
+            res.w[i] = ~w[i];
+        return res.Trim();
+    }
+    constexpr bool operator==(const Bitboard& b) const
+    {
+        for (int i = 0; i < Words; i++)
+            if (w[i] != b.w[i])
+                return false;
+        return true;
+    }
+    constexpr bool operator!=(const Bitboard& b) const
+    {
+        return !(*this == b);
+    }
+
+    // All cells of the grid
+    static constexpr Bitboard Full()
+    {
+        return Range(0, Cells - 1);
+    }
+    // The single cell (x, y)
+    static constexpr Bitboard Cell(int x, int y)
+    {
+        Bitboard res;
+        res.Set(x, y);
+        return res;
+    }
+    // The cells within the Chebyshev distance r from (x, y)
+    static constexpr Bitboard Square(int x, int y, int r)
+    {
+        Bitboard res;
+        int endy = y + r < H ? y + r : H - 1;
+        for (int i = x - r < 0 ? 0 : x - r; i <= x + r && i < W; i++)
+            res |= Range(Index(i, y - r < 0 ? 0 : y - r), Index(i, endy));
+        return res;
+    }
+    // The cells within the Manhattan distance r from (x, y)
+    static constexpr Bitboard Diamond(int x, int y, int r)
+    {
+        Bitboard res;
+        for (int i = x - r < 0 ? 0 : x - r; i <= x + r && i < W; i++)
+        {
+            int yd = r - (i < x ? x - i : i - x);
+            int starty = y - yd < 0 ? 0 : y - yd;
+            int endy = y + yd < H ? y + yd : H - 1;
+            res |= Range(Index(i, starty), Index(i, endy));
+        }
+        return res;
+    }
+
+    // The cells that share a side with a cell of the set
+    constexpr Bitboard Neighbours() const;
+    // The cells reachable from the set by moving to adjacent passable cells
+    constexpr Bitboard FloodFill(const Bitboard& passable) const
+    {
+        Bitboard reached = *this, prev;
+        do
+        {
+            prev = reached;
+            reached |= reached.Neighbours() & passable;
+        } while (reached != prev);
+        return reached;
+    }
+
+    template <int, int> friend struct BitboardMasks;
+};
+
+// The masks used by the shifts of Bitboard<W, H>
+template <int W, int H> struct BitboardMasks
+{
+    // A step along y must not wrap around to the next or the previous x
+    static constexpr Bitboard<W, H> NotFirstRow = ~Bitboard<W, H>::Row(0);
+    static constexpr Bitboard<W, H> NotLastRow = ~Bitboard<W, H>::Row(H - 1);
+};
+
+template <int W, int H>
+constexpr Bitboard<W, H> Bitboard<W, H>::Neighbours() const
+{
+    return ShiftUp(H) | ShiftDown(H) |
+           (ShiftUp(1) & BitboardMasks<W, H>::NotFirstRow) |
+           (ShiftDown(1) & BitboardMasks<W, H>::NotLastRow);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <vector>
+
+// A grid size known at compile time
+template <int W, int H> struct GridSize
+{
+    static constexpr int Width = W, Height = H;
+};
+
+// The grid sizes the programs are compiled for. Calls f(GridSize<W, H>())
+// if width by height is one of them and returns whether it is
+template <class F> bool WithGridSize(int width, int height, F&& f)
+{
+    if (width == 9 && height == 9)
+        f(GridSize<9, 9>());
+    else if (width == 64 && height == 64)
+        f(GridSize<64, 64>());
+    else if (width == 512 && height == 512)
+        f(GridSize<512, 512>());
+    else
+        return false;
+    return true;
+}
+
+// A W by H array of T, indexed as a[x][y]. Small arrays keep the elements in
+// place like a built-in array, large ones in a single heap buffer so that
+// they can be local variables
+template <class T, int W, int H> class GridArray
+{
+    static constexpr bool Inline = sizeof(T) * W * H <= 16384;
+    std::conditional_t<Inline, std::array<T, W * H>, std::vector<T>> data;
+
+public:
+    GridArray()
+    {
+        if constexpr (!Inline)
+            data.resize(W * H);
+    }
+    T* operator[](int x)
+    {
+        return data.data() + x * H;
+    }
+    const T* operator[](int x) const
+    {
+        return data.data() + x * H;
+    }
+    void Fill(const T& value)
+    {
+        std::fill(data.begin(), data.end(), value);
+    }
+};
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+// Lookup tables for the moves of Neo on a W by H grid, built at compile time
+// and shared by the solvers. The cells are numbered as in Bitboard: (x, y) is
+// x * H + y. The tables grow with the square of the number of cells, so large
+// grids compute the same answers on the fly instead
+template <int W, int H> struct GridTables
+{
+    static constexpr int Cells = W * H;
+    static constexpr bool Tabulated = Cells <= 256;
+    // The 4 directions of a step, in the order the solvers try them
+    static constexpr int DX[4] = {1, -1, 0, 0}, DY[4] = {0, 0, 1, -1};
+    // Wide enough for a cell or a distance
+    using Index = std::conditional_t<Tabulated, uint8_t, uint32_t>;
+
+    // Up to 4 cells adjacent to a cell
+    struct Neighbours
+    {
+        int count = 0;
+        Index cells[4]{};
+    };
+
+private:
+    static constexpr int TableCells = Tabulated ? Cells : 1;
+    // distance[a][b] = the Manhattan distance between the cells a and b
+    Index distance[TableCells][TableCells];
+    // adjacent[c] = the cells adjacent to c, in the order of the directions
+    Neighbours adjacent[TableCells];
+    // towards[c][Direction(c, t)] = the cells adjacent to c, those closer to
+    // the cell t first and in the order of the directions otherwise. A step
+    // either brings Neo one closer to t or takes Neo one further, so only the
+    // signs of the offset from c to t matter, and there are 9 orders per cell
+    Neighbours towards[TableCells][9];
+    uint8_t direction[TableCells][TableCells];
+
+    static constexpr int Sign(int x)
+    {
+        return (x > 0) - (x < 0);
+    }
+    static constexpr bool Valid(int x, int y)
+    {
+        return x >= 0 && x < W && y >= 0 && y < H;
+    }
+    static constexpr void Add(Neighbours& list, int x, int y)
+    {
+        if (Valid(x, y))
+            list.cells[list.count++] = Cell(x, y);
+    }
+    static constexpr int ComputeDistance(int a, int b)
+    {
+        int dx = b / H - a / H, dy = b % H - a % H;
+        return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+    }
+    static constexpr int ComputeDirection(int a, int b)
+    {
+        return (Sign(b / H - a / H) + 1) * 3 + Sign(b % H - a % H) + 1;
+    }
+    static constexpr Neighbours ComputeAdjacent(int c)
+    {
+        Neighbours res;
+        for (int i = 0; i < 4; i++)
+            Add(res, c / H + DX[i], c % H + DY[i]);
+        return res;
+    }
+    static constexpr Neighbours ComputeTowards(int c, int direction)
+    {
+        int sx = direction / 3 - 1, sy = direction % 3 - 1;
+        Neighbours res;
+        for (int closer = 1; closer >= 0; closer--)
+            for (int i = 0; i < 4; i++)
+            {
+                bool step = (DX[i] && DX[i] == sx) || (DY[i] && DY[i] == sy);
+                if (step == (closer == 1))
+                    Add(res, c / H + DX[i], c % H + DY[i]);
+            }
+        return res;
+    }
+
+public:
+    static constexpr int Cell(int x, int y)
+    {
+        return x * H + y;
+    }
+
+    constexpr GridTables() : distance(), adjacent(), towards(), direction()
+    {
+        if (!Tabulated)
+            return;
+        for (int a = 0; a < Cells; a++)
+        {
+            for (int b = 0; b < Cells; b++)
+            {
+                distance[a][b] = ComputeDistance(a, b);
+                direction[a][b] = ComputeDirection(a, b);
+            }
+            adjacent[a] = ComputeAdjacent(a);
+            for (int d = 0; d < 9; d++)
+                towards[a][d] = ComputeTowards(a, d);
+        }
+    }
+
+    // The Manhattan distance between the cells a and b
+    constexpr int Distance(int a, int b) const
+    {
+        if constexpr (Tabulated)
+            return distance[a][b];
+        else
+            return ComputeDistance(a, b);
+    }
+    // The cells adjacent to c, in the order of the directions
+    constexpr Neighbours Adjacent(int c) const
+    {
+        if constexpr (Tabulated)
+            return adjacent[c];
+        else
+            return ComputeAdjacent(c);
+    }
+    // The cells adjacent to c, the ones closer to t first
+    constexpr Neighbours Towards(int c, int t) const
+    {
+        if constexpr (Tabulated)
+            return towards[c][direction[c][t]];
+        else
+            return ComputeTowards(c, ComputeDirection(c, t));
+    }
+};
+
+template <int W, int H> inline constexpr GridTables<W, H> gridTables{};
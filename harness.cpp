@@ -0,0 +1,149 @@
+#include "interactorMap.h"
+#include "interactorSession.h"
+#include "reporting.h"
+#include "solver.h"
+#include "statistics.h"
+#include <chrono>
+#include <cstring>
+#include <functional>
+using namespace std;
+
+// Thrown when a linked solver breaks the rules, to stop it immediately
+struct SessionFailure
+{
+};
+
+// Lets a linked solver explore a map through an InteractorSession
+class SessionEnvironment : public Environment
+{
+    const Map& mp;
+    int radius;
+    InteractorSession session;
+    vector<pair<pair<int, int>, char>> vis;
+    vector<Observation> seen;
+    bool ok = false;
+
+public:
+    SessionEnvironment(const Map& mp, int radius)
+        : mp(mp), radius(radius), session(mp, radius)
+    {
+    }
+    void Start(int& variant, int& width, int& height, int& targetx,
+               int& targety) override
+    {
+        variant = radius;
+        width = mp.Width();
+        height = mp.Height();
+        auto km = mp.KeymakerCoords();
+        targetx = km.first;
+        targety = km.second;
+    }
+    const vector<Observation>& Move(int x, int y) override
+    {
+        if (!session.Move(x, y, vis))
+            throw SessionFailure();
+        seen.clear();
+        for (auto& p : vis)
+            seen.push_back({p.first.first, p.first.second, p.second});
+        return seen;
+    }
+    void Answer(int dist) override
+    {
+        ok = session.Answer(dist);
+    }
+    // Has the solver given the right answer without breaking the rules?
+    bool Passed() const
+    {
+        return ok;
+    }
+    int Moves() const
+    {
+        return session.Moves();
+    }
+    const string& Error() const
+    {
+        return session.Error();
+    }
+};
+
+// Time the solver on the tests given on the command line
+int Run(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        cout << "Usage: harness astar|back variant path/of/tests"
+             << endl;
+        return 0;
+    }
+    Backtracking::Player player;
+    bool back = strcmp(argv[1], "back") == 0;
+    function<int(Environment&)> solve;
+    if (strcmp(argv[1], "astar") == 0)
+        solve = AStar::Solve;
+    else if (back)
+        solve = [&](Environment& env) { return player.Solve(env); };
+    else
+    {
+        cout << "Unknown solver: " << argv[1] << endl;
+        return 1;
+    }
+    int variant = atoi(argv[2]);
+    Corpus corpus(argv[3]);
+    vector<string> testfiles;
+    vector<unique_ptr<Map>> maps;
+    for (size_t i = 0; i < corpus.Size(); i++)
+    {
+        maps.push_back(corpus.Load(i));
+        testfiles.push_back(corpus.Name(i));
+    }
+    long long testcount = maps.size();
+    vector<long long> times, moves;
+    int passedtests = 0;
+    auto start = chrono::steady_clock::now();
+    for (long long i = 0; i < testcount; i++)
+    {
+        SessionEnvironment env(*maps[i], variant);
+        auto teststart = chrono::steady_clock::now();
+        try
+        {
+            solve(env);
+        }
+        catch (SessionFailure&)
+        {
+        }
+        auto testend = chrono::steady_clock::now();
+        times.push_back(
+            chrono::duration_cast<chrono::nanoseconds>(testend - teststart)
+                .count());
+        moves.push_back(env.Moves());
+        if (env.Passed())
+            passedtests++;
+        else
+            cout << "Failure on \"" << testfiles[i] << "\": " << env.Error()
+                 << endl;
+    }
+    auto end = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(end - start).count();
+    cout << "Ran " << testcount << " tests in " << seconds << " s ("
+         << testcount / seconds << " tests per second).\n\n"
+         << "--Final Statistics--\n";
+    cout << "Execution time, in nanoseconds:\n";
+    PrintStats(times, cout);
+    cout << "Number of moves:\n";
+    PrintStats(moves, cout);
+    cout << "\nPassed tests: " << passedtests << "/" << testcount << endl;
+    if (back)
+    {
+        Backtracking::TableStats stats = player.Stats();
+        cout << "Transposition table: " << stats.hits << " hits out of "
+             << stats.probes << " probes ("
+             << (stats.probes ? 100.0 * stats.hits / stats.probes : 0.0)
+             << "%)" << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
+}
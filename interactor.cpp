@@ -1,5 +1,7 @@
 #include "interactorMap.h"
+#include "interactorSession.h"
 #include "launcher.h"
+#include "reporting.h"
 #include <bits/stdc++.h>
 #include <cctype>
 #include <chrono>
@@ -9,124 +11,205 @@
 #include <unistd.h>
 using namespace std;
 
-int main(int argc, char** argv)
+// How the tests are played
+struct Options
+{
+    bool showio = false;
+    bool stats = false;
+    bool binary = false;
+    long long timeoutms = 0; // Kill the solver after that long on a test
+    unique_ptr<AnswerIndex> answers;
+
+    // Check the answer of the solver against the index rather than a search
+    // of the map, if the index has the map
+    void UseAnswers(InteractorSession& session, const Map& mp) const
+    {
+        if (!answers)
+            return;
+        if (auto entry = answers->Find(mp))
+            session.ExpectAnswer(entry->answer);
+    }
+};
+
+// The resources used by the solver, as fields of the statistics
+void PrintUsage(const ResourceUsage& usage, char separator)
+{
+    cout << "user_us:" << usage.usertime << separator
+         << "sys_us:" << usage.systime << separator
+         << "maxrss_kb:" << usage.maxrss << separator
+         << "vcsw:" << usage.voluntaryswitches << separator
+         << "ivcsw:" << usage.involuntaryswitches << endl;
+}
+
+// The counters of the solver, if it reports them, as "name=value ..."
+string CountersText(const InteractorSession& session)
+{
+    string res;
+    for (auto& [name, value] : session.Counters())
+        res += (res.empty() ? "" : " ") + name + '=' + to_string(value);
+    return res;
+}
+
+// Feed all tests of the corpus to a single solver process started with
+// -batch. The solver is restarted after a failed test. The resources of a
+// solver process are only known when it ends, so with -stats they are
+// printed for each process rather than for each test
+int RunBatch(const string& program, const string& dir, int radius,
+             const Options& options)
+{
+    Corpus corpus(dir);
+    unique_ptr<Process> child;
+    int failed = 0;
+    for (size_t i = 0; i < corpus.Size(); i++)
+    {
+        // A map that cannot be read fails, and the others are still played
+        unique_ptr<Map> mp;
+        try
+        {
+            mp = corpus.Load(i);
+        }
+        catch (const exception& e)
+        {
+            cout << '"' << corpus.Name(i) << "\": " << e.what() << endl;
+            failed++;
+            continue;
+        }
+        if (!child)
+        {
+            vector<string> args{program, "-batch"};
+            if (options.binary)
+                args.push_back("-binary");
+            child = make_unique<Process>(program, args, vector<string>{});
+        }
+        InteractorSession session(*mp, radius);
+        options.UseAnswers(session, *mp);
+        child->SetTimeout(options.timeoutms);
+        auto start = chrono::steady_clock::now();
+        bool ok = session.Run(child->StdOUT(), child->StdIN(), options.showio);
+        auto end = chrono::steady_clock::now();
+        child->SetTimeout(0);
+        string killed;
+        ResourceUsage usage;
+        if (!ok)
+            killed = child->KillReason(child->Kill(50, &usage));
+        cout << '"' << corpus.Name(i) << "\": "
+             << (ok ? "OK" : session.Error());
+        if (!killed.empty())
+            cout << " (killed: " << killed << ")";
+        if (options.stats)
+            cout << " time_us:"
+                 << chrono::duration_cast<chrono::microseconds>(end - start)
+                        .count()
+                 << " moves:" << session.Moves();
+        if (options.stats && !session.Counters().empty())
+            cout << " counters:" << CountersText(session);
+        cout << endl;
+        if (!ok)
+        {
+            failed++;
+            child.reset();
+            if (options.stats)
+            {
+                cout << "Solver process: ";
+                PrintUsage(usage, ' ');
+            }
+        }
+    }
+    if (child)
+    {
+        ResourceUsage usage;
+        child->Wait(&usage);
+        if (options.stats)
+        {
+            cout << "Solver process: ";
+            PrintUsage(usage, ' ');
+        }
+    }
+    return failed != 0;
+}
+
+// Play the tests given on the command line
+int Run(int argc, char** argv)
 {
     if (argc <= 3)
     {
-        cout << "Usage: interactor [-io] [-stats] program.bin testfile.txt "
-                "variant"
+        cout << "Usage: interactor [-io] [-stats] [-binary] program.bin "
+                "testfile.txt variant\n"
+                "       interactor [-io] [-stats] [-binary] -index N "
+                "program.bin path/of/tests variant\n"
+                "       interactor [-io] [-stats] [-binary] -offset BYTES "
+                "program.bin tests.txt variant\n"
+                "       interactor [-io] [-stats] [-binary] -batch "
+                "program.bin path/of/tests variant\n"
+                "-answers answers.bin checks the answers against an index "
+                "written by oracle.bin\n"
+                "-timeout MS kills the solver if a test takes longer"
              << endl;
         return 0;
     }
-    bool showio = false;
-    bool stats = false;
+    Options options;
+    bool batch = false;
+    long long index = -1; // The map to play if the file has several
+    long long offset = -1; // Or the byte at which it starts in a text file
     int argsstart = 1;
     for (; argsstart < argc && argv[argsstart][0] == '-'; argsstart++)
     {
         if (strcmp(argv[argsstart], "-io") == 0)
-            showio = true;
+            options.showio = true;
         else if (strcmp(argv[argsstart], "-stats") == 0)
-            stats = true;
+            options.stats = true;
+        else if (strcmp(argv[argsstart], "-batch") == 0)
+            batch = true;
+        else if (strcmp(argv[argsstart], "-binary") == 0)
+            options.binary = true;
+        else if (strcmp(argv[argsstart], "-index") == 0 && argsstart + 1 < argc)
+            index = atoll(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-offset") == 0 &&
+                 argsstart + 1 < argc)
+            offset = atoll(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-answers") == 0 &&
+                 argsstart + 1 < argc)
+            options.answers = make_unique<AnswerIndex>(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-timeout") == 0 &&
+                 argsstart + 1 < argc)
+            options.timeoutms = atoll(argv[++argsstart]);
     }
-    Process child(argv[argsstart], {}, {});
+    if (batch)
+        return RunBatch(argv[argsstart], argv[argsstart + 1],
+                        atoi(argv[argsstart + 2]), options);
+    // Read the map first, so that no solver is left behind if it is bad
+    auto mp = offset != -1
+                  ? Corpus::LoadAt(argv[argsstart + 1], offset)
+                  : Corpus(argv[argsstart + 1]).Load(index == -1 ? 0 : index);
+    vector<string> args;
+    if (options.binary)
+        args = {argv[argsstart], "-binary"};
+    Process child(argv[argsstart], args, {});
     FILE *childw = child.StdIN(), *childr = child.StdOUT();
-    ifstream fs(argv[argsstart + 1]);
-    Map mp(fs);
-    fs.close();
     int radius = atoi(argv[argsstart + 2]);
-    fprintf(childw, "%d\n", radius);
-    if (showio)
-        cout << radius << endl;
-    {
-        auto km = mp.KeymakerCoords();
-        fprintf(childw, "%d %d\n", km.first, km.second);
-        if (showio)
-            cout << km.first << ' ' << km.second << endl;
-    }
-    fflush(childw);
-    bool ok = true;
-    int prevx = 0, prevy = 0;
-    int nmoves = 0;
+    InteractorSession session(*mp, radius);
+    options.UseAnswers(session, *mp);
+    child.SetTimeout(options.timeoutms);
     chrono::steady_clock* clock = nullptr;
     decltype(clock->now()) start;
-    if (stats)
+    if (options.stats)
     {
         clock = new chrono::steady_clock();
         start = clock->now();
     }
-    while (true)
+    bool ok = session.Run(childr, childw, options.showio);
+    string killed;
+    ResourceUsage usage;
+    if (!ok)
     {
-        char cmd;
-        do
-        {
-            fscanf(childr, "%c", &cmd);
-        } while (isspace(cmd));
-        if (cmd == 'm')
-        {
-            nmoves++;
-            int x, y;
-            fscanf(childr, "%d%d", &x, &y);
-            if (showio)
-                cout << ">>> m " << x << ' ' << y << endl;
-            if (abs(x - prevx) + abs(y - prevy) > 1)
-            {
-                cout << "Tried to move from (" << prevx << ", " << prevy
-                     << ") to (" << x << ", " << y << ")" << endl;
-                ok = false;
-                break;
-            }
-            if (!mp.CellIsSafe(x, y))
-            {
-                cout << "Cell (" << x << ", " << y << ") is unsafe!" << endl;
-                ok = false;
-                break;
-            }
-            prevx = x;
-            prevy = y;
-            auto vis = mp.Vision(x, y, radius);
-            fprintf(childw, "%d\n", (int)vis.size());
-            if (showio)
-                cout << vis.size() << endl;
-            for (auto& p : vis)
-            {
-                fprintf(childw, "%d %d %c\n", p.first.first, p.first.second,
-                        p.second);
-                if (showio)
-                {
-                    printf("%d %d %c\n", p.first.first, p.first.second,
-                           p.second);
-                    fflush(stdout);
-                }
-            }
-            fflush(childw);
-        }
-        else if (cmd == 'e')
-        {
-            int dist;
-            fscanf(childr, "%d", &dist);
-            if (showio)
-                cout << ">>> e " << dist << endl;
-            int expect = mp.Solution();
-            if (dist != expect)
-            {
-                cout << "Wrong answer: expected " << expect << ", got " << dist
-                     << endl;
-                ok = false;
-            }
-            break;
-        }
-        else
-        {
-            cout << "Wrong response: " << cmd << endl;
-            ok = false;
-            break;
-        }
+        cout << session.Error() << endl;
+        killed = child.KillReason(child.Kill(50, &usage));
+        if (!killed.empty())
+            cout << "Solver killed: " << killed << endl;
     }
-    if (!ok)
-        child.Kill();
     else
-        child.Wait();
-    if (stats)
+        killed = child.KillReason(child.Wait(&usage));
+    if (options.stats)
     {
         cout << "Stats:\n";
         auto end = clock->now();
@@ -135,7 +218,17 @@ int main(int argc, char** argv)
         using rat = decltype(dur)::period;
         long long us = (long long)dur.count() * rat::num * (int)1e6 / rat::den;
         cout << "time_us:" << us << '\n';
-        cout << "moves:" << nmoves << endl;
+        cout << "moves:" << session.Moves() << endl;
+        PrintUsage(usage, '\n');
+        if (!session.Counters().empty())
+            cout << "counters:" << CountersText(session) << endl;
+        if (!killed.empty())
+            cout << "killed:" << killed << endl;
     }
     return !ok;
 }
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
+}
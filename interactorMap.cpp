@@ -1,6 +1,18 @@
 #include "interactorMap.h"
+#include "bitboard.h"
+#include "gridSize.h"
+#include <algorithm>
+#include <charconv>
 #include <cstdlib>
-#include <queue>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 char KindToChar(CellKind cell)
@@ -31,128 +43,632 @@ bool CellIsSafe(CellKind cell)
                                        static_cast<int>(CellKind::Key))) == 0;
 }
 
-void Map::ManhattanPerception(int x, int y, int d)
+namespace
 {
-    int startx = max(0, x - d);
-    int endx = min(MaxX - 1, x + d);
-    for (int i = startx; i <= endx; i++)
-    {
-        int yd = d - abs(x - i);
-        int starty = max(0, y - yd);
-        int endy = min(MaxY - 1, y + yd);
-        for (int j = starty; j <= endy; j++)
-            if (i != x || j != y)
-                AddCellKind(i, j, CellKind::Perceived);
-    }
+// The number of bytes of a cell in a packed map
+int CellBytes(int cells)
+{
+    return cells < 256 ? 1 : 4;
 }
 
-void Map::ChebyshevPerception(int x, int y, int d)
+void PackCell(uint8_t* out, int bytes, int cell)
 {
-    int endx = min(MaxX - 1, x + d);
-    int endy = min(MaxY - 1, y + d);
-    for (int i = max(0, x - d); i <= endx; i++)
-        for (int j = max(0, y - d); j <= endy; j++)
-        {
-            if (i != x || j != y)
-                AddCellKind(i, j, CellKind::Perceived);
-        }
+    for (int i = 0; i < bytes; i++)
+        out[i] = (unsigned)cell >> (8 * i);
 }
 
-Map::Map(istream& in)
+int UnpackCell(const uint8_t* in, int bytes)
 {
-    fill_n(&v[0][0], MaxX * MaxY, CellKind::Empty);
-    for (int i = 0; i < MaxY; i++)
+    unsigned res = 0;
+    for (int i = 0; i < bytes; i++)
+        res |= (unsigned)in[i] << (8 * i);
+    return res == ~0U >> (32 - 8 * bytes) ? -1 : (int)res;
+}
+
+// The map on a W by H grid
+template <int W, int H> class GridMap : public Map
+{
+    using Cells = Bitboard<W, H>;
+    // One plane per kind of object: the cells with the flag 1 << k are
+    // planes[k]
+    static const int NKinds = 5;
+    Cells planes[NKinds];
+    inline Cells& Plane(CellKind ck)
+    {
+        return planes[__builtin_ctz((int)ck)];
+    }
+    inline const Cells& Plane(CellKind ck) const
+    {
+        return planes[__builtin_ctz((int)ck)];
+    }
+    inline void AddCellKind(int x, int y, CellKind ck)
+    {
+        Plane(ck).Set(x, y);
+    }
+    // Mark the cells around (x, y) within the distance d as perceived. The
+    // zones are small, so they are set cell by cell rather than as whole
+    // bitboards, which would cost a pass over a large grid
+    void ManhattanPerception(int x, int y, int d)
+    {
+        for (int i = -d; i <= d; i++)
+            for (int j = abs(i) - d; j <= d - abs(i); j++)
+                if ((i || j) && Cells::Valid(x + i, y + j))
+                    Plane(CellKind::Perceived).Set(x + i, y + j);
+    }
+    void ChebyshevPerception(int x, int y, int d)
+    {
+        for (int i = -d; i <= d; i++)
+            for (int j = -d; j <= d; j++)
+                if ((i || j) && Cells::Valid(x + i, y + j))
+                    Plane(CellKind::Perceived).Set(x + i, y + j);
+    }
+    // Put the object written as c in a map file at (x, y)
+    void Place(int x, int y, char c)
+    {
+        switch (c)
+        {
+        case 'A':
+            AddCellKind(x, y, CellKind::Agent);
+            ChebyshevPerception(x, y, 1);
+            break;
+        case 'S':
+            AddCellKind(x, y, CellKind::Sentinel);
+            ManhattanPerception(x, y, 1);
+            break;
+        case 'B':
+            AddCellKind(x, y, CellKind::Key);
+            break;
+        case 'K':
+            AddCellKind(x, y, CellKind::Keymaker);
+            break;
+        }
+    }
+    // The cells Neo may enter
+    Cells SafeCells() const
+    {
+        return ~(Plane(CellKind::Perceived) | Plane(CellKind::Agent) |
+                 Plane(CellKind::Sentinel));
+    }
+    // The first neighbour of the cell c in cells, in the order of the
+    // indices x * H + y, or -1 if there is none
+    static int FirstNeighbourIn(const Cells& cells, int c)
+    {
+        int x = c / H, y = c % H;
+        if (x > 0 && cells.Test(c - H))
+            return c - H;
+        if (y > 0 && cells.Test(c - 1))
+            return c - 1;
+        if (y < H - 1 && cells.Test(c + 1))
+            return c + 1;
+        if (x < W - 1 && cells.Test(c + H))
+            return c + H;
+        return -1;
+    }
+
+public:
+    static constexpr int PlaneBytes = (W * H + 7) / 8;
+
+    GridMap() = default;
+    // Read the row y of the map, padded with empty cells
+    void ReadRow(int y, string_view row)
+    {
+        for (int x = 0; x < W; x++)
+            Place(x, y, x < (int)row.size() ? row[x] : '.');
+    }
+    // Read a packed map, see Map::PackedSize
+    explicit GridMap(const uint8_t* record)
+    {
+        for (int plane = 0; plane < 2; plane++)
+            for (int i = 0; i < PlaneBytes; i++)
+                for (int bits = record[plane * PlaneBytes + i]; bits;
+                     bits &= bits - 1)
+                {
+                    int cell = i * 8 + __builtin_ctz(bits);
+                    Place(cell / H, cell % H, plane ? 'S' : 'A');
+                }
+        const uint8_t* cells = record + 2 * PlaneBytes;
+        int bytes = CellBytes(W * H);
+        for (char c : {'B', 'K'})
+        {
+            int cell = UnpackCell(cells, bytes);
+            if (cell != -1)
+                Place(cell / H, cell % H, c);
+            cells += bytes;
+        }
+    }
+    void Pack(uint8_t* record) const override
+    {
+        memset(record, 0, 2 * PlaneBytes);
+        CellKind kinds[2] = {CellKind::Agent, CellKind::Sentinel};
+        for (int plane = 0; plane < 2; plane++)
+        {
+            const Cells& cells = Plane(kinds[plane]);
+            for (int c = cells.First(); c != -1; c = cells.Next(c + 1))
+                record[plane * PlaneBytes + c / 8] |= 1 << (c % 8);
+        }
+        int bytes = CellBytes(W * H);
+        PackCell(record + 2 * PlaneBytes, bytes, Plane(CellKind::Key).First());
+        PackCell(record + 2 * PlaneBytes + bytes, bytes,
+                 Plane(CellKind::Keymaker).First());
+    }
+    int Width() const override
+    {
+        return W;
+    }
+    int Height() const override
+    {
+        return H;
+    }
+    CellKind Cell(int x, int y) const override
+    {
+        int res = 0;
+        for (int k = 0; k < NKinds; k++)
+            if (planes[k].Test(x, y))
+                res |= 1 << k;
+        return (CellKind)res;
+    }
+    pair<int, int> KeymakerCoords() const override
+    {
+        int cell = Plane(CellKind::Keymaker).First();
+        if (cell == -1)
+            return {-1, -1};
+        return {cell / H, cell % H};
+    }
+    vector<pair<pair<int, int>, char>> Vision(int x, int y,
+                                              int radius) const override
+    {
+        vector<pair<pair<int, int>, char>> res;
+        for (int i = x - radius; i <= x + radius; i++)
+            for (int j = y - radius; j <= y + radius; j++)
+            {
+                if (!Cells::Valid(i, j))
+                    continue;
+                int ck = (int)Cell(i, j);
+                while (ck)
+                {
+                    res.emplace_back(make_pair(i, j),
+                                     KindToChar((CellKind)(ck & -ck)));
+                    ck &= ck - 1;
+                }
+            }
+        return res;
+    }
+    bool CellIsSafe(int x, int y) const override
+    {
+        return ValidateCell(x, y) && !Plane(CellKind::Perceived).Test(x, y) &&
+               !Plane(CellKind::Agent).Test(x, y) &&
+               !Plane(CellKind::Sentinel).Test(x, y);
+    }
+    // Breadth-first search from (0, 0) that expands a whole frontier at a
+    // time. The Keymaker's cell may be unsafe, but it is still the goal
+    int Solution() const override
+    {
+        auto dest = KeymakerCoords();
+        if (dest.first == -1)
+            return -1;
+        Cells safe = SafeCells();
+        Cells frontier = Cells::Cell(0, 0), reached = frontier;
+        for (int dist = 1; !frontier.Empty(); dist++)
+        {
+            Cells next = frontier.Neighbours();
+            if (next.Test(dest.first, dest.second))
+                return dist;
+            frontier = next & safe & ~reached;
+            reached |= frontier;
+        }
+        return -1;
+    }
+    // The same search. Every cell reached keeps its parent, the first of its
+    // neighbours in the frontier before it, to walk the path back
+    vector<pair<int, int>> SolutionPath() const override
     {
-        string s;
-        in >> s;
-        for (int j = 0; j < MaxX; j++)
-            switch (s[j])
+        auto dest = KeymakerCoords();
+        if (dest.first == -1)
+            return {};
+        Cells safe = SafeCells();
+        vector<int> parent(W * H, -1);
+        Cells frontier = Cells::Cell(0, 0), reached = frontier;
+        for (int dist = 1; !frontier.Empty(); dist++)
+        {
+            Cells next = frontier.Neighbours();
+            if (next.Test(dest.first, dest.second))
             {
-            case 'A':
-                AddCellKind(j, i, CellKind::Agent);
-                ChebyshevPerception(j, i, 1);
-                break;
-            case 'S':
-                AddCellKind(j, i, CellKind::Sentinel);
-                ManhattanPerception(j, i, 1);
-                break;
-            case 'B':
-                AddCellKind(j, i, CellKind::Key);
-                break;
-            case 'K':
-                AddCellKind(j, i, CellKind::Keymaker);
-                break;
+                // Walk back from the Keymaker through the parents
+                vector<pair<int, int>> path(dist + 1);
+                int c = dest.first * H + dest.second;
+                parent[c] = FirstNeighbourIn(frontier, c);
+                for (int d = dist; d >= 0; d--)
+                {
+                    path[d] = {c / H, c % H};
+                    c = parent[c];
+                }
+                return path;
             }
+            next &= safe & ~reached;
+            for (int c = next.First(); c != -1; c = next.Next(c + 1))
+                parent[c] = FirstNeighbourIn(frontier, c);
+            frontier = next;
+            reached |= frontier;
+        }
+        return {};
     }
+};
+
+// Make a map from its rows, given by row(y)
+template <class F> unique_ptr<Map> ReadRows(int width, int height, F&& row)
+{
+    unique_ptr<Map> res;
+    if (!WithGridSize(width, height, [&](auto size) {
+            using Size = decltype(size);
+            auto mp = make_unique<GridMap<Size::Width, Size::Height>>();
+            for (int y = 0; y < Size::Height; y++)
+                mp->ReadRow(y, row(y));
+            res = move(mp);
+        }))
+        throw invalid_argument("Unsupported grid size " + to_string(width) +
+                               "x" + to_string(height));
+    return res;
 }
 
-pair<int, int> Map::KeymakerCoords() const
+// Remove the first word from the text and return it
+string_view NextWord(string_view& text)
 {
-    for (int i = 0; i < MaxX; i++)
-        for (int j = 0; j < MaxY; j++)
-            if ((int)v[i][j] & (int)CellKind::Keymaker)
-                return {i, j};
-    return {-1, -1};
+    const char* space = " \t\r\n";
+    size_t start = min(text.find_first_not_of(space), text.size());
+    size_t end = min(text.find_first_of(space, start), text.size());
+    string_view res = text.substr(start, end - start);
+    text.remove_prefix(end);
+    return res;
 }
 
-vector<pair<pair<int, int>, char>> Map::Vision(int x, int y, int radius) const
+int ParseInt(string_view word)
 {
-    std::vector<std::pair<std::pair<int, int>, char>> res;
-    int endx = min(MaxX - 1, x + radius);
-    int endy = min(MaxY - 1, y + radius);
-    for (int i = max(0, x - radius); i <= endx; i++)
-        for (int j = max(0, y - radius); j <= endy; j++)
-        {
-            int ck = (int)v[i][j];
-            while (ck)
-            {
-                res.emplace_back(make_pair(i, j),
-                                 KindToChar((CellKind)(ck & -ck)));
-                ck &= ck - 1;
-            }
-        }
+    int res = 0;
+    from_chars(word.data(), word.data() + word.size(), res);
+    return res;
+}
+} // namespace
+
+unique_ptr<Map> Map::Read(istream& in)
+{
+    int width = 9, height = 9;
+    string row;
+    in >> row;
+    if (row == "size")
+        in >> width >> height >> row;
+    return ReadRows(width, height, [&](int y) -> string_view {
+        if (y)
+            in >> row;
+        return row;
+    });
+}
+
+unique_ptr<Map> Map::Parse(string_view& text)
+{
+    int width = 9, height = 9;
+    string_view row = NextWord(text);
+    if (row == "size")
+    {
+        width = ParseInt(NextWord(text));
+        height = ParseInt(NextWord(text));
+        row = NextWord(text);
+    }
+    return ReadRows(width, height,
+                    [&](int y) { return y ? NextWord(text) : row; });
+}
+
+uint64_t Map::Hash() const
+{
+    vector<uint8_t> record(PackedSize(Width(), Height()));
+    Pack(record.data());
+    // splitmix64's finalizer over the words of the record
+    uint64_t res = (uint64_t)Width() << 32 | Height();
+    for (size_t i = 0; i < record.size(); i += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, record.data() + i, min<size_t>(8, record.size() - i));
+        res ^= word;
+        res = (res ^ res >> 30) * 0xBF58476D1CE4E5B9ULL;
+        res = (res ^ res >> 27) * 0x94D049BB133111EBULL;
+        res ^= res >> 31;
+    }
+    return res;
+}
+
+size_t Map::PackedSize(int width, int height)
+{
+    int cells = width * height;
+    return 2 * ((cells + 7) / 8) + 2 * CellBytes(cells);
+}
+
+unique_ptr<Map> Map::Unpack(int width, int height, const uint8_t* record)
+{
+    unique_ptr<Map> res;
+    if (!WithGridSize(width, height, [&](auto size) {
+            using Size = decltype(size);
+            res = make_unique<GridMap<Size::Width, Size::Height>>(record);
+        }))
+        throw invalid_argument("Unsupported grid size " + to_string(width) +
+                               "x" + to_string(height));
+    return res;
+}
+
+namespace
+{
+const char PackMagic[8] = {'M', 'A', 'P', 'P', 'A', 'C', 'K', '1'};
+const size_t PackHeaderSize = 24;
+const char AnswersMagic[8] = {'A', 'N', 'S', 'W', 'E', 'R', 'S', '1'};
+const size_t AnswersHeaderSize = 16;
+
+// Map the whole file into memory. An empty file gives nullptr
+const uint8_t* MapFile(const string& path, size_t& length)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0)
+    {
+        if (fd != -1)
+            close(fd);
+        throw runtime_error("Cannot open " + path);
+    }
+    length = st.st_size;
+    void* addr = nullptr;
+    if (length)
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        throw runtime_error("Cannot map " + path);
+    return (const uint8_t*)addr;
+}
+
+string ReadFile(const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw runtime_error("Cannot open " + path);
+    string res;
+    char buf[4096];
+    for (ssize_t n; (n = read(fd, buf, sizeof(buf))) > 0;)
+        res.append(buf, n);
+    close(fd);
     return res;
 }
 
-bool Map::CellIsSafe(int x, int y) const
+// Remove the first map from the text without building it. Returns false if
+// there is none
+bool SkipMap(string_view& text)
+{
+    string_view word = NextWord(text);
+    if (word.empty())
+        return false;
+    int rows = 9;
+    if (word == "size")
+    {
+        NextWord(text);
+        rows = ParseInt(NextWord(text)) + 1;
+    }
+    for (int i = 1; i < rows; i++)
+        NextWord(text);
+    return true;
+}
+} // namespace
+
+Corpus::Corpus(const string& path) : path(path)
+{
+    if (filesystem::is_directory(path))
+    {
+        for (auto& entry : filesystem::directory_iterator(path))
+            files.push_back(entry.path());
+        sort(files.begin(), files.end());
+        count = files.size();
+        return;
+    }
+    data = MapFile(path, length);
+    packed = length >= sizeof(PackMagic) &&
+             memcmp(data, PackMagic, sizeof(PackMagic)) == 0;
+    if (!packed)
+    {
+        string_view text((const char*)data, length);
+        offsets.push_back(0);
+        while (SkipMap(text))
+            offsets.push_back(length - text.size());
+        count = offsets.size() - 1;
+        return;
+    }
+
+    auto fail = [&](const string& why) {
+        munmap((void*)data, length);
+        throw runtime_error(path + ": " + why);
+    };
+    if (length < PackHeaderSize)
+        fail("truncated");
+    uint32_t size[2];
+    memcpy(size, data + 8, sizeof(size));
+    memcpy(&count, data + 16, sizeof(uint64_t));
+    width = size[0];
+    height = size[1];
+    if (!WithGridSize(width, height, [](auto) {}))
+        fail("unsupported grid size");
+    recordsize = Map::PackedSize(width, height);
+    records = data + PackHeaderSize;
+    size_t namesstart = PackHeaderSize + count * recordsize;
+    uint64_t nameslength = 0;
+    if (namesstart + (count + 1) * 8 <= length)
+        memcpy(&nameslength, data + namesstart + count * 8, 8);
+    if (namesstart + (count + 1) * 8 + nameslength > length)
+        fail("truncated");
+    names = (const char*)data + namesstart;
+}
+
+Corpus::~Corpus()
+{
+    if (data)
+        munmap((void*)data, length);
+}
+
+unique_ptr<Map> Corpus::Load(size_t index) const
+{
+    if (index >= count)
+        throw out_of_range("No map " + to_string(index) + " in " + path);
+    if (packed)
+        return Map::Unpack(width, height, records + index * recordsize);
+    if (!files.empty())
+    {
+        string contents = ReadFile(files[index]);
+        string_view text = contents;
+        return Map::Parse(text);
+    }
+    string_view text((const char*)data + offsets[index],
+                     offsets[index + 1] - offsets[index]);
+    return Map::Parse(text);
+}
+
+string Corpus::Name(size_t index) const
+{
+    if (!files.empty())
+        return files[index];
+    if (!packed)
+        return count == 1 ? path : path + ':' + to_string(index);
+    uint64_t bounds[2];
+    memcpy(bounds, names + index * 8, sizeof(bounds));
+    return path + ':' +
+           string(names + (count + 1) * 8 + bounds[0], bounds[1] - bounds[0]);
+}
+
+string Corpus::File(size_t index) const
+{
+    if (!files.empty())
+        return files[index];
+    return !packed && count == 1 ? path : "";
+}
+
+long long Corpus::Offset(size_t index) const
+{
+    return files.empty() && !packed && count > 1 ? offsets[index] : -1;
+}
+
+unique_ptr<Map> Corpus::LoadAt(const string& file, long long offset)
+{
+    ifstream in(file);
+    if (!in)
+        throw runtime_error("Cannot open " + file);
+    if (offset < 0 || !in.seekg(offset) || (in >> ws).eof())
+        throw out_of_range("No map at byte " + to_string(offset) + " of " +
+                           file);
+    return Map::Read(in);
+}
+
+CorpusWriter::CorpusWriter(int width, int height, size_t count)
+    : width(width), height(height), recordsize(Map::PackedSize(width, height)),
+      records(count * recordsize), names(count)
+{
+}
+
+void CorpusWriter::Set(size_t index, const string& name, const Map& mp)
 {
-    return ValidateCell(x, y) && ::CellIsSafe(v[x][y]);
+    mp.Pack(records.data() + index * recordsize);
+    names[index] = name;
 }
 
-int Map::Solution() const
+void CorpusWriter::Write(ostream& out) const
 {
-    std::pair<int, int> adj[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
-    int dists[MaxX][MaxY];
-    fill_n(&dists[0][0], MaxX * MaxY, -1);
-    dists[0][0] = 0;
-    queue<std::pair<int, int>> q;
-    q.emplace(0, 0);
-    int destx, desty;
+    uint32_t size[2] = {(uint32_t)width, (uint32_t)height};
+    uint64_t count = names.size();
+    out.write(PackMagic, sizeof(PackMagic));
+    out.write((const char*)size, sizeof(size));
+    out.write((const char*)&count, sizeof(count));
+    out.write((const char*)records.data(), records.size());
+    uint64_t offset = 0;
+    out.write((const char*)&offset, sizeof(offset));
+    for (auto& name : names)
     {
-        auto p = KeymakerCoords();
-        destx = p.first;
-        desty = p.second;
+        offset += name.size();
+        out.write((const char*)&offset, sizeof(offset));
     }
-    while (q.size())
+    for (auto& name : names)
+        out << name;
+}
+
+AnswerIndex::AnswerIndex(const string& path)
+{
+    data = MapFile(path, length);
+    auto fail = [&](const string& why) {
+        if (data)
+            munmap((void*)data, length);
+        throw runtime_error(path + ": " + why);
+    };
+    if (length < AnswersHeaderSize ||
+        memcmp(data, AnswersMagic, sizeof(AnswersMagic)) != 0)
+        fail("not an answer index");
+    memcpy(&count, data + 8, sizeof(uint64_t));
+    if (count > (length - AnswersHeaderSize) / sizeof(Entry))
+        fail("truncated");
+    entries = (const Entry*)(data + AnswersHeaderSize);
+    cells = (const uint16_t*)(entries + count);
+    // The paths are stored in the order of the entries, but the last entries
+    // may be unsolvable, so every path must fit
+    size_t ncells = 0;
+    for (size_t i = 0; i < count; i++)
     {
-        auto p = q.front();
-        q.pop();
-        int x = p.first;
-        int y = p.second;
-        int newdist = dists[x][y] + 1;
-        for (auto d : adj)
+        const Entry& e = entries[i];
+        if (e.answer < -1 || (i && e.offset < entries[i - 1].offset))
+            fail("corrupt entry " + to_string(i));
+        if (e.answer != -1)
+            ncells = max(ncells, (size_t)e.offset + e.answer + 1);
+    }
+    if (ncells > (size_t)(data + length - (const uint8_t*)cells) / 4)
+        fail("truncated");
+}
+
+AnswerIndex::~AnswerIndex()
+{
+    if (data)
+        munmap((void*)data, length);
+}
+
+const AnswerIndex::Entry* AnswerIndex::Find(const Map& mp) const
+{
+    uint64_t hash = mp.Hash();
+    auto it = lower_bound(
+        entries, entries + count, hash,
+        [](const Entry& e, uint64_t hash) { return e.hash < hash; });
+    return it != entries + count && it->hash == hash ? it : nullptr;
+}
+
+vector<pair<int, int>> AnswerIndex::Path(const Entry& entry) const
+{
+    vector<pair<int, int>> res(entry.answer + 1);
+    const uint16_t* cell = cells + 2 * (size_t)entry.offset;
+    for (auto& p : res)
+    {
+        p = {cell[0], cell[1]};
+        cell += 2;
+    }
+    return res;
+}
+
+void AnswerIndex::Write(
+    ostream& out, vector<pair<uint64_t, vector<pair<int, int>>>> answers)
+{
+    sort(answers.begin(), answers.end(),
+         [](auto& a, auto& b) { return a.first < b.first; });
+    answers.erase(unique(answers.begin(), answers.end(),
+                         [](auto& a, auto& b) { return a.first == b.first; }),
+                  answers.end());
+    uint64_t count = answers.size();
+    out.write(AnswersMagic, sizeof(AnswersMagic));
+    out.write((const char*)&count, sizeof(count));
+    uint32_t offset = 0;
+    for (auto& [hash, path] : answers)
+    {
+        Entry entry{hash, (int32_t)path.size() - 1, offset};
+        out.write((const char*)&entry, sizeof(entry));
+        offset += path.size();
+    }
+    for (auto& [hash, path] : answers)
+        for (auto [x, y] : path)
         {
-            int nx = x + d.first;
-            int ny = y + d.second;
-            if (nx == destx && ny == desty)
-                return newdist;
-            if (!CellIsSafe(nx, ny))
-                continue;
-            if (dists[nx][ny] != -1)
-                continue;
-            dists[nx][ny] = newdist;
-            q.emplace(nx, ny);
+            uint16_t cell[2] = {(uint16_t)x, (uint16_t)y};
+            out.write((const char*)cell, sizeof(cell));
         }
-    }
-    return -1;
 }
@@ -1,5 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 enum class CellKind
@@ -15,33 +19,179 @@ enum class CellKind
 char KindToChar(CellKind cell);
 bool CellIsSafe(CellKind cell);
 
+// A map as the interactor knows it. The grid is one of the sizes listed in
+// gridSize.h, and each size has its own implementation
 class Map
 {
 public:
-    static const int MaxX = 9, MaxY = 9;
-    static inline bool ValidateCell(int x, int y)
+    virtual ~Map() = default;
+    // Read a map: an optional "size W H" header, then H rows of W cells.
+    // Without the header, the map is 9 by 9. Throws std::invalid_argument if
+    // the size is not supported
+    static std::unique_ptr<Map> Read(std::istream& in);
+    // Read a map in the same format from the start of the text, and remove
+    // it from the text
+    static std::unique_ptr<Map> Parse(std::string_view& text);
+    // The number of bytes of a packed W by H map: a plane of agents and a
+    // plane of sentinels, one bit per cell numbered as in Bitboard, then the
+    // cells of the key and of the Keymaker, one byte each if the grid has
+    // fewer than 256 cells and four otherwise, all ones if absent. A 9 by 9
+    // map takes 24 bytes
+    static size_t PackedSize(int width, int height);
+    // Read a packed map. Throws std::invalid_argument if the size is not
+    // supported
+    static std::unique_ptr<Map> Unpack(int width, int height,
+                                       const uint8_t* record);
+    // Write the map into PackedSize() bytes. Only the first key and Keymaker
+    // are kept
+    virtual void Pack(uint8_t* record) const = 0;
+    // A hash of the packed map, which identifies it in an AnswerIndex
+    uint64_t Hash() const;
+
+    virtual int Width() const = 0;
+    virtual int Height() const = 0;
+    inline bool ValidateCell(int x, int y) const
     {
-        return x >= 0 && x < MaxX && y >= 0 && y < MaxY;
+        return x >= 0 && x < Width() && y >= 0 && y < Height();
     }
+    virtual std::pair<int, int> KeymakerCoords() const = 0;
+    virtual std::vector<std::pair<std::pair<int, int>, char>> Vision(
+        int x, int y, int radius) const = 0;
+    virtual bool CellIsSafe(int x, int y) const = 0;
+    virtual int Solution() const = 0;
+    // A shortest path from (0, 0) to the Keymaker, both included, or an
+    // empty path if there is none
+    virtual std::vector<std::pair<int, int>> SolutionPath() const = 0;
+    virtual CellKind Cell(int x, int y) const = 0;
+};
 
-private:
-    CellKind v[MaxX][MaxY];
-    inline void AddCellKind(int x, int y, CellKind ck)
+// A set of test maps, numbered from 0. A corpus is one of:
+//   - a directory of map files, numbered in the order of their names;
+//   - a text file of maps written one after another, such as a single map
+//     file or the concatenation of a directory;
+//   - a packed file, written by CorpusWriter.
+// Text and packed files are read through mmap, and their maps are built
+// straight from the mapped bytes, in any order and from several threads at
+// once. A text file is scanned once, when the corpus is opened, to find where
+// its maps start. A directory opens and parses the file of a map on each
+// Load.
+//
+// A packed file holds:
+//   - the header: "MAPPACK1", the width and the height of the maps as 32-bit
+//     integers and the number of maps as a 64-bit integer;
+//   - the maps, Map::PackedSize() bytes each;
+//   - the index of the names: the number of maps + 1 64-bit offsets into the
+//     names, the i-th name being between the offsets i and i + 1;
+//   - the names of the maps, concatenated.
+// The integers are little-endian
+class Corpus
+{
+    std::string path;
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    // Packed files
+    bool packed = false;
+    int width = 0, height = 0;
+    size_t recordsize = 0;
+    const uint8_t* records = nullptr;
+    const char* names = nullptr;
+    // Text files: where each map starts, and where the last one ends
+    std::vector<size_t> offsets;
+    // Directories
+    std::vector<std::string> files;
+
+public:
+    // Throws std::runtime_error if the path cannot be read
+    explicit Corpus(const std::string& path);
+    ~Corpus();
+    Corpus(const Corpus&) = delete;
+    Corpus& operator=(const Corpus&) = delete;
+
+    const std::string& Path() const
+    {
+        return path;
+    }
+    size_t Size() const
     {
-        v[x][y] = (CellKind)((int)v[x][y] | (int)ck);
+        return count;
     }
-    void ManhattanPerception(int x, int y, int d);
-    void ChebyshevPerception(int x, int y, int d);
+    // Throws std::out_of_range if there is no such map, and what Map::Read
+    // throws for a bad map
+    std::unique_ptr<Map> Load(size_t index) const;
+    // The name of the map to report: the path of its file, followed by its
+    // name in a packed file or its number in a text file of several maps
+    std::string Name(size_t index) const;
+    // The file that holds the map alone, or "" if it shares its file
+    std::string File(size_t index) const;
+    // The byte at which the map starts if it shares a text file, or -1
+    long long Offset(size_t index) const;
+    // Read the map that starts at the given byte of a text file, without
+    // scanning the maps before it. Throws std::runtime_error if the file
+    // cannot be read, std::out_of_range if no map starts there, and what
+    // Map::Read throws for a bad map
+    static std::unique_ptr<Map> LoadAt(const std::string& file,
+                                       long long offset);
+};
+
+// Builds a corpus of a known number of maps of the same size. The maps may be
+// set in any order, and from several threads if their indices differ
+class CorpusWriter
+{
+    int width, height;
+    size_t recordsize;
+    std::vector<uint8_t> records;
+    std::vector<std::string> names;
+
+public:
+    CorpusWriter(int width, int height, size_t count);
+    void Set(size_t index, const std::string& name, const Map& mp);
+    void Write(std::ostream& out) const;
+};
 
+// The answers to a set of maps, computed once by oracle.bin so that they are
+// looked up rather than searched for on every test. The maps are identified
+// by Map::Hash(). The file, read through mmap, holds:
+//   - the header: "ANSWERS1" and the number of maps as a 64-bit integer;
+//   - an Entry per map, sorted by hash;
+//   - the paths of the solvable maps, 16-bit x then 16-bit y per cell.
+// The integers are little-endian
+class AnswerIndex
+{
 public:
-    Map(std::istream& in);
-    std::pair<int, int> KeymakerCoords() const;
-    std::vector<std::pair<std::pair<int, int>, char>> Vision(int x, int y,
-                                                             int radius) const;
-    bool CellIsSafe(int x, int y) const;
-    int Solution() const;
-    inline CellKind Cell(int x, int y)
+    struct Entry
+    {
+        uint64_t hash;
+        int32_t answer;  // -1 if the map is unsolvable
+        uint32_t offset; // The first cell of the path among all the paths
+    };
+
+private:
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    const Entry* entries = nullptr;
+    const uint16_t* cells = nullptr;
+
+public:
+    // Throws std::runtime_error if the file cannot be read or is not an
+    // index
+    explicit AnswerIndex(const std::string& path);
+    ~AnswerIndex();
+    AnswerIndex(const AnswerIndex&) = delete;
+    AnswerIndex& operator=(const AnswerIndex&) = delete;
+
+    size_t Size() const
     {
-        return v[x][y];
+        return count;
     }
+    // The answer for the map, or nullptr if the map is not in the index
+    const Entry* Find(const Map& mp) const;
+    // The shortest path stored for the entry, as Map::SolutionPath()
+    std::vector<std::pair<int, int>> Path(const Entry& entry) const;
+    // Write an index of the maps with the given hashes and shortest paths
+    static void Write(
+        std::ostream& out,
+        std::vector<std::pair<uint64_t, std::vector<std::pair<int, int>>>>
+            answers);
 };
@@ -0,0 +1,188 @@
+#include "interactorSession.h"
+#include "protocol.h"
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+InteractorSession::InteractorSession(const Map& mp, int radius)
+    : mp(mp), radius(radius)
+{
+}
+
+bool InteractorSession::Move(int x, int y,
+                             vector<pair<pair<int, int>, char>>& seen)
+{
+    nmoves++;
+    if (abs(x - prevx) + abs(y - prevy) > 1)
+    {
+        error = "Tried to move from (" + to_string(prevx) + ", " +
+                to_string(prevy) + ") to (" + to_string(x) + ", " +
+                to_string(y) + ")";
+        return false;
+    }
+    if (!mp.CellIsSafe(x, y))
+    {
+        error = "Cell (" + to_string(x) + ", " + to_string(y) + ") is unsafe!";
+        return false;
+    }
+    prevx = x;
+    prevy = y;
+    seen = mp.Vision(x, y, radius);
+    return true;
+}
+
+bool InteractorSession::Answer(int dist)
+{
+    int expect = knownanswer ? expected : mp.Solution();
+    if (dist != expect)
+    {
+        error = "Wrong answer: expected " + to_string(expect) + ", got " +
+                to_string(dist);
+        return false;
+    }
+    return true;
+}
+
+// Read a little-endian number of the given size from the binary framing
+static unsigned int ReadNumber(FILE* in, int bytes)
+{
+    unsigned int res = 0;
+    for (int i = 0; i < bytes; i++)
+        res |= (unsigned int)(fgetc(in) & 0xFF) << (8 * i);
+    return res;
+}
+
+// Write what is seen from (x, y) as the bit planes of the binary framing
+static void WritePlanes(FILE* out, int x, int y, int radius,
+                        const vector<pair<pair<int, int>, char>>& vis)
+{
+    int side = 2 * radius + 1;
+    int planebytes = BinaryProtocol::PlaneBytes(radius);
+    vector<unsigned char> frame(planebytes * BinaryProtocol::NPlanes);
+    for (auto& p : vis)
+    {
+        int plane = strchr(BinaryProtocol::PlaneKinds, p.second) -
+                    BinaryProtocol::PlaneKinds;
+        int bit = (p.first.first - x + radius) * side +
+                  (p.first.second - y + radius);
+        frame[plane * planebytes + bit / 8] |= 1 << (bit % 8);
+    }
+    fwrite(frame.data(), 1, frame.size(), out);
+}
+
+vector<pair<string, long long>> InteractorSession::ParseCounters(
+    const string& text)
+{
+    vector<pair<string, long long>> res;
+    istringstream in(text);
+    string field;
+    while (in >> field)
+    {
+        size_t eq = field.find('=');
+        if (eq != string::npos)
+            res.emplace_back(field.substr(0, eq),
+                             atoll(field.c_str() + eq + 1));
+    }
+    return res;
+}
+
+bool InteractorSession::Run(FILE* childr, FILE* childw, bool showio)
+{
+    // The size of the grid is only given if it is not the usual 9 by 9
+    string first = to_string(radius);
+    if (mp.Width() != 9 || mp.Height() != 9)
+        first += ' ' + to_string(mp.Width()) + ' ' + to_string(mp.Height());
+    fprintf(childw, "%s\n", first.c_str());
+    if (showio)
+        cout << first << endl;
+    {
+        auto km = mp.KeymakerCoords();
+        fprintf(childw, "%d %d\n", km.first, km.second);
+        if (showio)
+            cout << km.first << ' ' << km.second << endl;
+    }
+    fflush(childw);
+    vector<pair<pair<int, int>, char>> vis;
+    while (true)
+    {
+        char cmd;
+        do
+        {
+            if (fscanf(childr, "%c", &cmd) != 1)
+            {
+                error = "Unexpected end of output";
+                return false;
+            }
+        } while (isspace(cmd));
+        if (cmd == 'm' || cmd == BinaryProtocol::Move)
+        {
+            bool binary = cmd == BinaryProtocol::Move;
+            int x, y;
+            if (binary)
+            {
+                x = (int16_t)ReadNumber(childr, 2);
+                y = (int16_t)ReadNumber(childr, 2);
+            }
+            else
+                fscanf(childr, "%d%d", &x, &y);
+            if (showio)
+                cout << ">>> " << cmd << ' ' << x << ' ' << y << endl;
+            if (!Move(x, y, vis))
+                return false;
+            if (binary)
+                WritePlanes(childw, x, y, radius, vis);
+            else
+                fprintf(childw, "%d\n", (int)vis.size());
+            if (showio)
+                cout << vis.size() << endl;
+            for (auto& p : vis)
+            {
+                if (!binary)
+                    fprintf(childw, "%d %d %c\n", p.first.first,
+                            p.first.second, p.second);
+                if (showio)
+                {
+                    printf("%d %d %c\n", p.first.first, p.first.second,
+                           p.second);
+                    fflush(stdout);
+                }
+            }
+            fflush(childw);
+        }
+        else if (cmd == 'c')
+        {
+            // The counters of the solver, on the rest of the line
+            char buf[1024];
+            string line;
+            while (fgets(buf, sizeof(buf), childr))
+            {
+                line += buf;
+                if (line.back() == '\n')
+                    break;
+            }
+            if (showio)
+                cout << ">>> c" << line << flush;
+            counters = ParseCounters(line);
+        }
+        else if (cmd == 'e' || cmd == BinaryProtocol::Answer)
+        {
+            int dist;
+            if (cmd == BinaryProtocol::Answer)
+                dist = (int)ReadNumber(childr, 4);
+            else
+                fscanf(childr, "%d", &dist);
+            if (showio)
+                cout << ">>> " << cmd << ' ' << dist << endl;
+            return Answer(dist);
+        }
+        else
+        {
+            error = string("Wrong response: ") + cmd;
+            return false;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "interactorMap.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Plays the role of the Actor for a solver exploring a single map
+class InteractorSession
+{
+    const Map& mp;
+    int radius;
+    int prevx = 0, prevy = 0;
+    int nmoves = 0;
+    int expected = 0;
+    bool knownanswer = false;
+    std::string error;
+    std::vector<std::pair<std::string, long long>> counters;
+
+public:
+    InteractorSession(const Map& mp, int radius);
+    // Check that Neo can move to (x, y) and list what is seen from there.
+    // Returns false if the move is illegal; see Error()
+    bool Move(int x, int y,
+              std::vector<std::pair<std::pair<int, int>, char>>& seen);
+    // Use the given answer, from an AnswerIndex, instead of searching the map
+    void ExpectAnswer(int answer)
+    {
+        expected = answer;
+        knownanswer = true;
+    }
+    // Check the final answer of the solver
+    bool Answer(int dist);
+    // Talk to the solver through the given streams until it gives an answer
+    // or breaks the rules. If showio is set, echo the dialogue to stdout
+    bool Run(FILE* childr, FILE* childw, bool showio = false);
+    // The number of moves made so far
+    int Moves() const
+    {
+        return nmoves;
+    }
+    // Why the session has failed
+    const std::string& Error() const
+    {
+        return error;
+    }
+    // The counters reported by a solver built with SOLVER_COUNTERS, as
+    // (name, value), or none
+    const std::vector<std::pair<std::string, long long>>& Counters() const
+    {
+        return counters;
+    }
+    // Read counters written as "name=value name=value ..."
+    static std::vector<std::pair<std::string, long long>> ParseCounters(
+        const std::string& text);
+};
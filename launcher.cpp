@@ -1,6 +1,15 @@
 #include "launcher.h"
+#include <cerrno>
+#include <chrono>
 #include <csignal>
 #include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 using namespace std;
@@ -9,25 +18,35 @@ Process::Process(const string& filename, vector<string> argv,
                  vector<string> env, void (*doBeforeChild)(void* params),
                  void* doBeforeChildParams)
 {
-    int _tochild[2];
-    int _fromchild[2];
-    pipe(_tochild);
-    pipe(_fromchild);
-    child = fork();
+    // Prepare everything before forking: the child of a multithreaded
+    // parent must not allocate memory before execve
+    vector<char*> _argv(argv.size() + 1);
+    for (size_t i = 0; i < argv.size(); i++)
+        _argv[i] = argv[i].data();
+    vector<char*> _env(env.size() + 1);
+    for (size_t i = 0; i < env.size(); i++)
+        _env[i] = env[i].data();
+    // The pipes are close-on-exec, so that the processes launched
+    // concurrently from other threads do not inherit them
+    int _tochild[2] = {-1, -1};
+    int _fromchild[2] = {-1, -1};
+    if (pipe2(_tochild, O_CLOEXEC) == -1 ||
+        pipe2(_fromchild, O_CLOEXEC) == -1 || (child = fork()) == -1)
+    {
+        int error = errno;
+        for (int fd : {_tochild[0], _tochild[1], _fromchild[0], _fromchild[1]})
+            if (fd != -1)
+                close(fd);
+        throw runtime_error("Cannot start " + filename + ": " +
+                            strerror(error));
+    }
     if (!child)
     {
-        close(_tochild[1]);
-        close(_fromchild[0]);
         dup2(_tochild[0], STDIN_FILENO);
         dup2(_fromchild[1], STDOUT_FILENO);
         doBeforeChild(doBeforeChildParams);
-        vector<char*> _argv(argv.size() + 1);
-        for (size_t i = 0; i < argv.size(); i++)
-            _argv[i] = argv[i].data();
-        vector<char*> _env(env.size() + 1);
-        for (size_t i = 0; i < env.size(); i++)
-            _env[i] = env[i].data();
         execve(filename.c_str(), _argv.data(), _env.data());
+        _exit(127);
     }
     close(_tochild[0]);
     close(_fromchild[1]);
@@ -43,6 +62,35 @@ Process::Process(const string& filename, const vector<string>& argv,
 {
 }
 
+// Runs in the child before execve, so it only makes system calls
+static void ApplyLimits(void* params)
+{
+    auto limits = (const ProcessLimits*)params;
+    if (limits->group)
+        setpgid(0, 0);
+    if (limits->cpuseconds)
+    {
+        rlimit cpu{(rlim_t)limits->cpuseconds, (rlim_t)limits->cpuseconds + 1};
+        setrlimit(RLIMIT_CPU, &cpu);
+    }
+    if (limits->memorybytes)
+    {
+        rlimit as{(rlim_t)limits->memorybytes, (rlim_t)limits->memorybytes};
+        setrlimit(RLIMIT_AS, &as);
+    }
+}
+
+Process::Process(const string& filename, const vector<string>& argv,
+                 const vector<string>& env, const ProcessLimits& limits)
+    : Process(filename, argv, env, ApplyLimits, (void*)&limits)
+{
+    group = limits.group;
+    // Also from the parent, in case it kills the group before the child
+    // has made it
+    if (group && child > 0)
+        setpgid(child, child);
+}
+
 FILE* Process::StdIN() const
 {
     return childw;
@@ -58,32 +106,154 @@ pid_t Process::PID() const
     return child;
 }
 
-int Process::Wait()
+static long long Now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Process::SetTimeout(long long ms)
+{
+    deadline = ms ? Now() + ms * 1000000 : 0;
+    if (!watchdog.joinable())
+    {
+        if (!ms)
+            return;
+        pidfd = syscall(SYS_pidfd_open, child, 0);
+        wakefd = eventfd(0, EFD_CLOEXEC);
+        watchdog = thread(&Process::Watch, this);
+    }
+    else
+        eventfd_write(wakefd, 1);
+}
+
+void Process::Watch()
+{
+    while (!stopwatch)
+    {
+        long long end = deadline;
+        int timeout = -1;
+        if (end)
+            timeout = max(0LL, (end - Now() + 999999) / 1000000);
+        // Without pidfd (before Linux 5.3), only the deadline is watched
+        pollfd fds[2] = {{wakefd, POLLIN, 0}, {pidfd, POLLIN, 0}};
+        int ready = poll(fds, pidfd == -1 ? 1 : 2, timeout);
+        if (stopwatch || (ready > 0 && fds[1].revents))
+            return;
+        if (ready > 0)
+        {
+            eventfd_t value;
+            eventfd_read(wakefd, &value);
+            continue;
+        }
+        if (ready == 0 && deadline && Now() >= deadline)
+        {
+            // The child has not been reaped yet, see Wait, so its pid and
+            // its group are still its own
+            timedout = true;
+            KillChild();
+            return;
+        }
+    }
+}
+
+void Process::StopWatchdog()
+{
+    if (!watchdog.joinable())
+        return;
+    stopwatch = true;
+    eventfd_write(wakefd, 1);
+    watchdog.join();
+    if (pidfd != -1)
+        close(pidfd);
+    close(wakefd);
+}
+
+static void Reap(pid_t child, int& stat, int options, ResourceUsage* usage)
+{
+    rusage ru{};
+    wait4(child, &stat, options, &ru);
+    if (!usage)
+        return;
+    usage->usertime = ru.ru_utime.tv_sec * 1000000LL + ru.ru_utime.tv_usec;
+    usage->systime = ru.ru_stime.tv_sec * 1000000LL + ru.ru_stime.tv_usec;
+    usage->maxrss = ru.ru_maxrss;
+    usage->voluntaryswitches = ru.ru_nvcsw;
+    usage->involuntaryswitches = ru.ru_nivcsw;
+}
+
+int Process::Wait(ResourceUsage* usage)
 {
     int stat;
     CloseAll();
-    waitpid(child, &stat, 0);
+    // Wait for the exit without reaping the child, so that the watchdog
+    // cannot kill another process that reuses the pid
+    siginfo_t info;
+    waitid(P_PID, child, &info, WEXITED | WNOWAIT);
+    StopWatchdog();
+    Reap(child, stat, 0, usage);
     terminated = true;
     return stat;
 }
 
-void Process::Kill()
+int Process::Kill(int gracems, ResourceUsage* usage)
 {
+    int stat;
     CloseAll();
-    kill(child, SIGKILL);
+    StopWatchdog();
+    if (gracems)
+    {
+        pollfd fd{(int)syscall(SYS_pidfd_open, child, 0), POLLIN, 0};
+        if (fd.fd != -1)
+        {
+            poll(&fd, 1, gracems);
+            close(fd.fd);
+        }
+    }
+    // The child has exited if it can be waited for without reaping it
+    siginfo_t info{};
+    waitid(P_PID, child, &info, WEXITED | WNOHANG | WNOWAIT);
+    bool exited = info.si_pid == child;
+    if (!exited)
+        KillChild();
+    Reap(child, stat, 0, usage);
     terminated = true;
+    return exited ? stat : -1;
+}
+
+// A pid of -1 would signal every process of the user, and 0 the group of the
+// caller, so only a child that has really been started is signalled
+void Process::KillChild()
+{
+    if (child <= 0)
+        return;
+    if (group)
+        killpg(child, SIGKILL);
+    else
+        kill(child, SIGKILL);
 }
 
 Process::~Process()
 {
+    StopWatchdog();
     if (!terminated)
         CloseAll();
 }
 
+// fclose also closes the descriptors of the pipes
 void Process::CloseAll()
 {
     fclose(childw);
     fclose(childr);
-    close(tochild);
-    close(fromchild);
+}
+
+string Process::KillReason(int status) const
+{
+    if (timedout)
+        return "wall-clock timeout";
+    if (status == -1 || !WIFSIGNALED(status))
+        return "";
+    int sig = WTERMSIG(status);
+    return "signal " + to_string(sig) + " (" + strsignal(sig) + ")";
 }
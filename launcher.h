@@ -1,26 +1,77 @@
 #pragma once
+#include <atomic>
 #include <csignal>
 #include <string>
+#include <thread>
 #include <vector>
 
+// Limits on a child process, applied before it starts. 0 means no limit
+struct ProcessLimits
+{
+    int cpuseconds = 0;        // RLIMIT_CPU: SIGXCPU, SIGKILL 1 s later
+    long long memorybytes = 0; // RLIMIT_AS: allocations beyond it fail
+    // Start a process group, so that a timeout also kills the processes the
+    // child has started
+    bool group = false;
+};
+
+// The resources used by a process, and by the children it has waited for,
+// from wait4
+struct ResourceUsage
+{
+    long long usertime = 0, systime = 0; // CPU time, in microseconds
+    long long maxrss = 0;                // Peak resident set, in kilobytes
+    long long voluntaryswitches = 0, involuntaryswitches = 0;
+};
+
 class Process
 {
-    pid_t child;
+    pid_t child = -1;
     int tochild, fromchild;
     FILE *childw, *childr;
     bool terminated = false;
+    bool group = false;
+    // The watchdog kills the child at the deadline (nanoseconds of
+    // steady_clock, 0 if none). It polls a pidfd of the child, to stop when
+    // the child exits, and an eventfd, to learn of a new deadline
+    std::thread watchdog;
+    int pidfd = -1, wakefd = -1;
+    std::atomic<long long> deadline = 0;
+    std::atomic<bool> stopwatch = false, timedout = false;
     void CloseAll();
+    void KillChild();
+    void Watch();
+    void StopWatchdog();
 
 public:
+    // Throws std::runtime_error if the pipes or the process cannot be made
     Process(const std::string& filename, std::vector<std::string> argv,
             std::vector<std::string> env, void (*doBeforeChild)(void* params),
             void* doBeforeChildParams);
     Process(const std::string& filename, const std::vector<std::string>& argv,
             const std::vector<std::string>& env);
+    Process(const std::string& filename, const std::vector<std::string>& argv,
+            const std::vector<std::string>& env, const ProcessLimits& limits);
     FILE* StdIN() const;
     FILE* StdOUT() const;
     pid_t PID() const;
-    int Wait();
-    void Kill();
+    // Kill the child, and its group if it has one, if it is still running
+    // ms milliseconds from now. 0 cancels the timeout
+    void SetTimeout(long long ms);
+    // Whether the child was killed by the timeout
+    bool TimedOut() const
+    {
+        return timedout;
+    }
+    // Close the pipes and wait for the child to exit. Returns the status
+    // from waitpid, and fills usage if it is given
+    int Wait(ResourceUsage* usage = nullptr);
+    // Kill the child unless it exits within gracems milliseconds, as a
+    // child that has just closed its pipes may be doing. Returns the status
+    // from waitpid if the child has exited, and -1 if it was killed
+    int Kill(int gracems = 0, ResourceUsage* usage = nullptr);
+    // Why the child was killed, given the status from Wait or Kill: the
+    // timeout or a signal such as SIGXCPU. "" if it exited or Kill killed it
+    std::string KillReason(int status) const;
     ~Process();
 };
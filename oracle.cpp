@@ -0,0 +1,38 @@
+#include "interactorMap.h"
+#include "reporting.h"
+#include <fstream>
+using namespace std;
+
+// Index the answers of the tests given on the command line
+int Run(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        cout << "Usage: oracle path/of/tests answers.bin" << endl;
+        cout << "Computes the answer and a shortest path of every test, for "
+                "interactor -answers and tester -answers"
+             << endl;
+        return 0;
+    }
+    Corpus corpus(argv[1]);
+    vector<pair<uint64_t, vector<pair<int, int>>>> answers;
+    int unsolvable = 0;
+    for (size_t i = 0; i < corpus.Size(); i++)
+    {
+        auto mp = corpus.Load(i);
+        auto path = mp->SolutionPath();
+        if (path.empty())
+            unsolvable++;
+        answers.emplace_back(mp->Hash(), move(path));
+    }
+    ofstream fs(argv[2], ios::binary);
+    AnswerIndex::Write(fs, move(answers));
+    cout << "Indexed " << corpus.Size() << " tests, " << unsolvable
+         << " of them unsolvable" << endl;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// The compact binary framing of the protocol. A solver started with -binary
+// uses it for the moves and the answer; the interactor recognizes it by the
+// command letter and replies in kind. The initial variant (followed by the
+// grid size if it is not 9 by 9) and Keymaker coordinates are always sent as
+// text, and so is the line "c name=value ..." of the counters that a solver
+// built with SOLVER_COUNTERS sends right before its answer (see solver.h).
+//
+// Solver:     'M' x y  - move to (x, y); 16-bit little-endian numbers
+//             'E' dist - the answer; a 32-bit little-endian number
+// Interactor: after each move, one plane per object kind, in the order of
+//             PlaneKinds. A plane is a bitmask over the (2r+1)x(2r+1) window
+//             around Neo: the cell (x + i, y + j) has the bit
+//             (i + r) * (2r + 1) + (j + r), packed little-endian into
+//             PlaneBytes(r) bytes.
+namespace BinaryProtocol
+{
+constexpr char Move = 'M', Answer = 'E';
+// The mnemonics of the objects, one per plane
+constexpr char PlaneKinds[] = "PABSK";
+constexpr int NPlanes = sizeof(PlaneKinds) - 1;
+inline int PlaneBytes(int radius)
+{
+    int side = 2 * radius + 1;
+    return (side * side + 7) / 8;
+}
+} // namespace BinaryProtocol
@@ -0,0 +1,19 @@
+#pragma once
+#include <exception>
+#include <iostream>
+
+// Run the body of a tool's main, and report an exception that escapes it,
+// such as the one for a corpus or a map that cannot be read, on stderr
+// rather than leave it to std::terminate. Returns 1 in that case
+inline int RunReporting(int (*run)(int, char**), int argc, char** argv)
+{
+    try
+    {
+        return run(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -1,10 +1,8 @@
 #!/bin/bash
 make -s shortestPathLength.bin
-for file in $1
+./shortestPathLength.bin -l $1 | while read -r file len
 do
-    len=$(./shortestPathLength.bin $file)
     if [ $len -eq -1 ]; then
         echo $file
     fi
 done
-
@@ -1,17 +1,47 @@
 #include "interactorMap.h"
+#include "reporting.h"
 #include <bits/stdc++.h>
 using namespace std;
 
-int main(int argc, char** argv)
+// Print the answers of the tests given on the command line
+int Run(int argc, char** argv)
 {
-    if (argc < 2)
+    bool label = false;
+    int argsstart = 1;
+    for (; argsstart < argc && argv[argsstart][0] == '-'; argsstart++)
+    {
+        if (strcmp(argv[argsstart], "-l") == 0)
+            label = true;
+    }
+    if (argsstart >= argc)
     {
-        cout << "Usage: shortestPathLength testfile.txt" << endl;
+        cout << "Usage: shortestPathLength [-l] "
+                "testfile.txt|directory|corpus.bin..."
+             << endl;
+        cout << "With several tests, or with -l, each answer is preceded "
+                "by the test's path"
+             << endl;
         return 0;
     }
-    fstream fs(argv[1], ios::in);
-    Map mp(fs);
-    fs.close();
-    cout << mp.Solution() << endl;
+    vector<unique_ptr<Corpus>> corpora;
+    size_t testcount = 0;
+    for (int i = argsstart; i < argc; i++)
+    {
+        corpora.push_back(make_unique<Corpus>(argv[i]));
+        testcount += corpora.back()->Size();
+    }
+    label = label || testcount > 1;
+    for (auto& corpus : corpora)
+        for (size_t i = 0; i < corpus->Size(); i++)
+        {
+            if (label)
+                cout << corpus->Name(i) << ' ';
+            cout << corpus->Load(i)->Solution() << '\n';
+        }
     return 0;
 }
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include "gridSize.h"
+#include "protocol.h"
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Counters of the work done by the solvers in a game, to tell why a map is
+// slow. They are compiled in with -DSOLVER_COUNTERS; otherwise counting
+// compiles to nothing. The solver reports them and resets them with each
+// answer
+namespace Counters
+{
+enum Counter
+{
+    Expanded,      // Nodes expanded by the main search
+    QueueInserts,  // Insertions into the priority queues of A*
+    QueueErases,   // Removals from them
+    SafePaths,     // Calls of A*'s SafePath
+    SafePathNodes, // Nodes expanded by those calls
+    CanContinue,   // Calls of the backtracking's CanContinuePath
+    MaxDepth,      // The length of the longest path of the backtracking
+    Backtracks,    // Moves back along the path of the backtracking
+    NCounters
+};
+// The names in the reports
+constexpr const char* Names[NCounters] = {
+    "expanded",       "pq_inserts",  "pq_erases", "safepaths",
+    "safepath_nodes", "cancontinue", "max_depth", "backtracks"};
+#ifdef SOLVER_COUNTERS
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+inline long long values[NCounters];
+
+inline void Count(Counter counter, long long n = 1)
+{
+    if constexpr (Enabled)
+        values[counter] += n;
+}
+inline void Max(Counter counter, long long value)
+{
+    if constexpr (Enabled)
+        if (values[counter] < value)
+            values[counter] = value;
+}
+} // namespace Counters
+
+// An object that Neo sees in the cell (x, y), given by its mnemonic
+struct Observation
+{
+    int x, y;
+    char type;
+};
+
+// Turns what Neo sees into the knowledge of a solver's map on a TopX by TopY
+// grid. Everything within vision is empty, unless something is seen there.
+// The objects are collected first and every cell is assigned once, so that
+// the map only registers a change if the knowledge about the cell is new
+template <int TopX, int TopY> class Surroundings
+{
+    GridArray<unsigned char, TopX, TopY> kinds;
+
+public:
+    // Handle what Neo sees from (x, y). The map's cells are bitmasks of the
+    // kinds that fromchar gives for the mnemonics
+    template <class SolverMap, class FromChar>
+    void Read(SolverMap& mp, int x, int y, int radius,
+              const std::vector<Observation>& seen, FromChar fromchar)
+    {
+        using Kind = decltype(fromchar(' '));
+        auto inview = [&](int cx, int cy) {
+            return SolverMap::ValidateCell(cx, cy) &&
+                   std::abs(cx - x) <= radius && std::abs(cy - y) <= radius;
+        };
+        for (int i = -radius; i <= radius; i++)
+            for (int j = -radius; j <= radius; j++)
+                if (SolverMap::ValidateCell(x + i, y + j))
+                    kinds[x + i][y + j] = static_cast<int>(Kind::Empty);
+        for (const Observation& obs : seen)
+            if (inview(obs.x, obs.y))
+                kinds[obs.x][obs.y] |= static_cast<int>(fromchar(obs.type));
+        for (int i = -radius; i <= radius; i++)
+            for (int j = -radius; j <= radius; j++)
+                if (SolverMap::ValidateCell(x + i, y + j))
+                    mp.Set(x + i, y + j,
+                           static_cast<Kind>(kinds[x + i][y + j]));
+        // Objects out of view are added as they are; Add ignores the ones
+        // off the grid
+        for (const Observation& obs : seen)
+            if (!inview(obs.x, obs.y))
+                mp.Add(obs.x, obs.y, fromchar(obs.type));
+    }
+};
+
+// The world explored by a solver
+class Environment
+{
+public:
+    virtual ~Environment() = default;
+    // Learn how far Neo sees, the size of the grid and where the Keymaker is
+    virtual void Start(int& variant, int& width, int& height, int& targetx,
+                       int& targety) = 0;
+    // Move Neo to (x, y) and list everything seen from there.
+    // The list is valid until the next move
+    virtual const std::vector<Observation>& Move(int x, int y) = 0;
+    // Report the length of the shortest path to the Keymaker, or -1
+    virtual void Answer(int dist) = 0;
+};
+
+// The environment of the Codeforces problem: the interactor is on the other
+// side of stdin and stdout. Optionally, the moves and the answer use the
+// binary framing described in protocol.h
+class StdioEnvironment : public Environment
+{
+    bool binary;
+    int radius = 0;
+    std::vector<Observation> seen;
+    std::vector<unsigned char> frame;
+
+    void WriteNumber(unsigned int value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++, value >>= 8)
+            std::cout.put(static_cast<char>(value & 0xFF));
+    }
+
+public:
+    StdioEnvironment(bool binary = false) : binary(binary)
+    {
+    }
+    void Start(int& variant, int& width, int& height, int& targetx,
+               int& targety) override
+    {
+        // The first line is the radius, and then the size of the grid unless
+        // it is 9 by 9
+        std::string line;
+        std::getline(std::cin >> std::ws, line);
+        std::istringstream first(line);
+        first >> variant;
+        if (!(first >> width >> height))
+            width = height = 9;
+        std::cin >> targetx >> targety;
+        radius = variant;
+        // The binary frames follow right after the end of the line
+        if (binary)
+            std::cin.ignore(INT_MAX, '\n');
+    }
+    const std::vector<Observation>& Move(int x, int y) override
+    {
+        if (!binary)
+        {
+            std::cout << "m " << x << ' ' << y << std::endl;
+            int n;
+            std::cin >> n;
+            seen.resize(n);
+            for (Observation& obs : seen)
+                std::cin >> obs.x >> obs.y >> obs.type;
+            return seen;
+        }
+        std::cout.put(BinaryProtocol::Move);
+        WriteNumber(x, 2);
+        WriteNumber(y, 2);
+        std::cout.flush();
+        int side = 2 * radius + 1;
+        int planebytes = BinaryProtocol::PlaneBytes(radius);
+        frame.resize(planebytes * BinaryProtocol::NPlanes);
+        std::cin.read(reinterpret_cast<char*>(frame.data()), frame.size());
+        seen.clear();
+        for (int k = 0; k < BinaryProtocol::NPlanes; k++)
+        {
+            const unsigned char* plane = frame.data() + k * planebytes;
+            for (int bit = 0; bit < side * side; bit++)
+                if (plane[bit / 8] >> (bit % 8) & 1)
+                    seen.push_back({x + bit / side - radius,
+                                    y + bit % side - radius,
+                                    BinaryProtocol::PlaneKinds[k]});
+        }
+        return seen;
+    }
+    void Answer(int dist) override
+    {
+        // The counters are a line of text in both framings, before the answer
+        if constexpr (Counters::Enabled)
+        {
+            std::cout << 'c';
+            for (int i = 0; i < Counters::NCounters; i++)
+            {
+                std::cout << ' ' << Counters::Names[i] << '='
+                          << Counters::values[i];
+                Counters::values[i] = 0;
+            }
+            std::cout << '\n';
+        }
+        if (!binary)
+        {
+            std::cout << "e " << dist << std::endl;
+            return;
+        }
+        std::cout.put(BinaryProtocol::Answer);
+        WriteNumber(static_cast<unsigned int>(dist), 4);
+        std::cout.flush();
+    }
+    // Will the interactor start another game?
+    bool HasNextGame()
+    {
+        return !(std::cin >> std::ws).eof();
+    }
+};
+
+// The solvers play a single game in the given environment and return the
+// answer they have reported
+namespace AStar
+{
+int Solve(Environment& env);
+}
+namespace Backtracking
+{
+class TranspositionTable;
+// How often the search has found a state it had already explored
+struct TableStats
+{
+    long long probes, hits;
+};
+// Plays games one after another. The search remembers the states it has
+// explored in a transposition table, which is kept between the games
+class Player
+{
+    std::unique_ptr<TranspositionTable> table;
+
+public:
+    Player();
+    ~Player();
+    int Solve(Environment& env);
+    // The totals over the games played so far
+    TableStats Stats() const;
+};
+} // namespace Backtracking
+
+// Play the game on stdin/stdout with solve, called as solve(env). With
+// -batch, keep playing new games until the interactor closes the input. With
+// -binary, use the binary framing of the protocol
+template <class Solve> int RunStdio(int argc, char** argv, Solve solve)
+{
+    bool batch = false, binary = false;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "-batch") == 0)
+            batch = true;
+        else if (strcmp(argv[i], "-binary") == 0)
+            binary = true;
+    StdioEnvironment env(binary);
+    do
+        solve(env);
+    while (batch && env.HasNextGame());
+    return 0;
+}
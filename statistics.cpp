@@ -0,0 +1,175 @@
+#include "statistics.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+static constexpr int Exact = 1 << Statistics::SignificantBits;
+static constexpr int Half = Exact / 2;
+
+int Statistics::Bucket(unsigned long long magnitude)
+{
+    if (magnitude < Exact)
+        return magnitude;
+    // Keep the SignificantBits highest bits, the highest of which is 1
+    int shift = 64 - __builtin_clzll(magnitude) - SignificantBits;
+    return Exact + (shift - 1) * Half + (int)(magnitude >> shift) - Half;
+}
+
+unsigned long long Statistics::BucketLow(int bucket)
+{
+    if (bucket < Exact)
+        return bucket;
+    int shift = (bucket - Exact) / Half + 1;
+    return (unsigned long long)((bucket - Exact) % Half + Half) << shift;
+}
+
+unsigned long long Statistics::BucketHigh(int bucket)
+{
+    if (bucket < Exact)
+        return bucket;
+    int shift = (bucket - Exact) / Half + 1;
+    return BucketLow(bucket) + (1ULL << shift) - 1;
+}
+
+long long Statistics::BucketValue(int bucket, bool isnegative) const
+{
+    unsigned long long low = BucketLow(bucket), high = BucketHigh(bucket);
+    long long middle = low + (high - low) / 2;
+    return clamp(isnegative ? -middle : middle, min, max);
+}
+
+void Statistics::Add(long long value)
+{
+    if (count == 0 || value < min)
+        min = value;
+    if (count == 0 || value > max)
+        max = value;
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    auto& buckets = value < 0 ? negative : positive;
+    int bucket = Bucket(value < 0 ? 0 - (unsigned long long)value : value);
+    if ((int)buckets.size() <= bucket)
+        buckets.resize(bucket + 1);
+    buckets[bucket]++;
+}
+
+void Statistics::Merge(const Statistics& other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    long long total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * count / total * other.count;
+    count = total;
+    for (auto [buckets, others] :
+         {pair{&positive, &other.positive}, pair{&negative, &other.negative}})
+    {
+        if (buckets->size() < others->size())
+            buckets->resize(others->size());
+        for (size_t i = 0; i < others->size(); i++)
+            (*buckets)[i] += (*others)[i];
+    }
+}
+
+double Statistics::StandardDeviation() const
+{
+    return count ? sqrt(m2 / count) : 0;
+}
+
+double Statistics::MeanError() const
+{
+    return count > 1 ? 1.96 * sqrt(m2 / (count - 1) / count) : 0;
+}
+
+long long Statistics::Percentile(double q) const
+{
+    if (count == 0)
+        return 0;
+    long long rank = std::max(1LL, (long long)ceil(q * count)), seen = 0;
+    // The negative values from the furthest from 0, then the others
+    for (int i = (int)negative.size() - 1; i >= 0; i--)
+        if ((seen += negative[i]) >= rank)
+            return BucketValue(i, true);
+    for (int i = 0; i < (int)positive.size(); i++)
+        if ((seen += positive[i]) >= rank)
+            return BucketValue(i, false);
+    return max;
+}
+
+long long Statistics::Mode(long long& occurrences) const
+{
+    long long res = 0;
+    occurrences = 0;
+    for (int i = (int)negative.size() - 1; i >= 0; i--)
+        if (negative[i] > occurrences)
+        {
+            occurrences = negative[i];
+            res = BucketValue(i, true);
+        }
+    for (int i = 0; i < (int)positive.size(); i++)
+        if (positive[i] > occurrences)
+        {
+            occurrences = positive[i];
+            res = BucketValue(i, false);
+        }
+    return res;
+}
+
+void Statistics::Print(ostream& stream) const
+{
+    if (count == 0)
+    {
+        stream << "No values\n";
+        return;
+    }
+    auto flags = stream.flags();
+    auto precision = stream.precision();
+    stream.setf(ios::fixed);
+    stream.precision(8);
+    stream << "Mean: " << mean << '\n';
+    stream << "Standard deviation: " << StandardDeviation() << '\n';
+    stream.flags(flags);
+    stream.precision(precision);
+    long long occurrences;
+    long long mode = Mode(occurrences);
+    stream << "Mode: " << mode << " (" << occurrences << " occurrences)\n";
+    stream << "Min: " << min << '\n';
+    stream << "Median: " << Percentile(0.5) << '\n';
+    stream << "90th percentile: " << Percentile(0.9) << '\n';
+    stream << "99th percentile: " << Percentile(0.99) << '\n';
+    stream << "99.9th percentile: " << Percentile(0.999) << '\n';
+    stream << "Max: " << max << endl;
+}
+
+double SignTest(long long better, long long worse)
+{
+    long long n = better + worse, k = std::min(better, worse);
+    if (n == 0)
+        return 1;
+    // Twice the binomial probability of at most k of n, summed in logarithms
+    double lognchoosei = 0, p = 0, loghalf = n * log(0.5);
+    for (long long i = 0; i <= k; i++)
+    {
+        p += exp(lognchoosei + loghalf);
+        lognchoosei += log((double)(n - i) / (i + 1));
+    }
+    return std::min(1.0, 2 * p);
+}
+
+void PrintStats(const vector<long long>& vals, ostream& stream)
+{
+    Statistics stats;
+    for (auto i : vals)
+        stats.Add(i);
+    stats.Print(stream);
+}
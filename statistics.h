@@ -0,0 +1,71 @@
+#pragma once
+#include <iostream>
+#include <vector>
+
+// The statistics of a stream of values, kept in memory that does not grow
+// with the number of values: the count, the extremes, the mean and the
+// variance (by Welford's method), and a histogram for the mode and the
+// percentiles. The histogram counts the values below 2^SignificantBits
+// exactly and the larger ones in buckets as wide as 1 / 2^(SignificantBits -
+// 1) of their values, like an HDR histogram. The statistics of two parts of a
+// stream merge into those of the whole, so that parallel workers can keep
+// their own
+class Statistics
+{
+public:
+    static constexpr int SignificantBits = 8;
+
+    void Add(long long value);
+    void Merge(const Statistics& other);
+
+    long long Count() const
+    {
+        return count;
+    }
+    long long Min() const
+    {
+        return min;
+    }
+    long long Max() const
+    {
+        return max;
+    }
+    double Mean() const
+    {
+        return mean;
+    }
+    double StandardDeviation() const;
+    // Half the width of the 95% confidence interval of the mean, by the
+    // normal approximation
+    double MeanError() const;
+    // The least value that a fraction q of the values do not exceed, within
+    // the width of its bucket
+    long long Percentile(double q) const;
+    // The middle of the fullest bucket, and in occurrences its count
+    long long Mode(long long& occurrences) const;
+
+    // Print the mean, the standard deviation, the mode, the extremes and the
+    // median, 90th, 99th and 99.9th percentiles
+    void Print(std::ostream& stream) const;
+
+private:
+    long long count = 0, min = 0, max = 0;
+    double mean = 0, m2 = 0;
+    // The counts of the buckets of the values >= 0, and of the values < 0 by
+    // their absolute values. They grow up to the largest bucket used
+    std::vector<long long> positive, negative;
+
+    static int Bucket(unsigned long long magnitude);
+    static unsigned long long BucketLow(int bucket);
+    static unsigned long long BucketHigh(int bucket);
+    // The value that stands for the values of a bucket
+    long long BucketValue(int bucket, bool isnegative) const;
+};
+
+// The two-sided p-value of the sign test of paired samples: the probability
+// that, if neither sample tends to be larger, the larger values split between
+// them at least as unevenly as better to worse. Ties are left out
+double SignTest(long long better, long long worse);
+
+// Print the statistics of vals
+void PrintStats(const std::vector<long long>& vals, std::ostream& stream);
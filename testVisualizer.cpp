@@ -1,26 +1,25 @@
 #include "interactorMap.h"
-#include <fstream>
+#include "reporting.h"
 using namespace std;
 
-int main(int argc, char** argv)
+// Draw the test given on the command line
+int Run(int argc, char** argv)
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        cout << "Usage: testVisualizer testfile.txt" << endl;
+        cout << "Usage: testVisualizer testfile.txt|corpus [index]" << endl;
         return 0;
     }
-    fstream fs(argv[1], ios::in);
-    Map mp(fs);
-    fs.close();
+    auto mp = Corpus(argv[1]).Load(argc == 3 ? atoll(argv[2]) : 0);
 
     cout << "\\begin{tikzpicture}\n";
     cout << "    \\node at (0.5,-0.5) {\\Huge{N}};\n";
-    for (int i = 0; i < 9; i++)
-        for (int j = 0; j < 9; j++)
+    for (int i = 0; i < mp->Width(); i++)
+        for (int j = 0; j < mp->Height(); j++)
         {
             if (i == 0 && j == 0)
                 continue;
-            int kind = (int)mp.Cell(i, j);
+            int kind = (int)mp->Cell(i, j);
             if (kind & (int)CellKind::Perceived)
             {
                 cout << "    \\fill[pink] (" << i << ',' << -j << ") rectangle"
@@ -31,6 +30,13 @@ int main(int argc, char** argv)
                 cout << "    \\node at (" << i << ".5,-" << j << ".5) {"
                      << "\\Huge{" << KindToChar((CellKind)kind) << "}};\n";
         }
-    cout << "    \\draw[very thick, step=1.0] (0,0) grid (9,-9);\n";
+    cout << "    \\draw[very thick, step=1.0] (0,0) grid (" << mp->Width()
+         << ',' << -mp->Height() << ");\n";
     cout << "\\end{tikzpicture}\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
 }
@@ -1,124 +1,701 @@
+#include "interactorMap.h"
+#include "interactorSession.h"
 #include "launcher.h"
+#include "reporting.h"
+#include "statistics.h"
 #include <algorithm>
 #include <bits/stdc++.h>
+#include <csignal>
 #include <cstdio>
-#include <filesystem>
 #include <sstream>
 using namespace std;
 
-void PrintStats(vector<long long> vals, ostream& stream)
+// The outcome of running the interactor on a single test
+struct TestResult
 {
-    int n = vals.size();
-    double mean = 0;
-    for (auto i : vals)
-        mean += i;
-    mean /= n;
-    stream << "Mean: ";
-    stream.setf(ios::fixed);
-    stream.precision(8);
-    stream << mean << '\n';
-    sort(vals.begin(), vals.end());
-    int mode = -1, run = 0, maxrun = -1;
-    long long prev = vals[0];
-    for (auto i : vals)
-    {
-        if (prev == i)
-            run++;
+    bool passed = false;
+    long long time = 0, moves = 0;
+    bool hasoptimum = false; // Whether the answer to the map is known
+    int optimum = -1; // The answer from the index or a search, -1 if none
+    string killed;    // Why a limit or a signal killed the run, if it did
+    string error;     // Why the test could not be run, if it could not
+    // What the solver used. In the persistent mode a process plays many
+    // tests, and usage is that of the whole process if it ended on the test
+    bool hasusage = false, processended = false;
+    ResourceUsage usage;
+    // What a solver built with SOLVER_COUNTERS counted, if it is one
+    vector<pair<string, long long>> counters;
+
+    // killed, failed, time_limit if passed slower than 1 s, or passed
+    const char* Verdict() const
+    {
+        if (!killed.empty())
+            return "killed";
+        if (!passed)
+            return "failed";
+        return time > (int)1e6 ? "time_limit" : "passed";
+    }
+};
+
+// How the tests are run
+struct TestSetup
+{
+    string progfile, variant, invokerfile;
+    bool direct = false;     // Talk to the solver without the interactor
+    bool persistent = false; // Keep the solver alive between tests
+    bool binary = false;     // Use the binary framing of the protocol
+    string answersfile;      // The answers written by oracle.bin, if any
+    shared_ptr<AnswerIndex> answers;
+    bool searchanswers = false; // Search for the answers not in the index
+    long long timeoutms = 10000; // Kill a test that runs longer, 0: never
+    ProcessLimits limits{0, 0, true};
+
+    // The command line of the solver when it is launched by the tester
+    vector<string> SolverArgs() const
+    {
+        vector<string> args{progfile};
+        if (persistent)
+            args.push_back("-batch");
+        if (binary)
+            args.push_back("-binary");
+        return args;
+    }
+    // Whether UseAnswer finds the answers
+    bool UsesAnswers() const
+    {
+        return answers || searchanswers;
+    }
+    // Look the answer for the map up in the index, if there is one, or
+    // search for it if searchanswers is set
+    void UseAnswer(const Map& mp, InteractorSession* session,
+                   TestResult& res) const
+    {
+        auto entry = answers ? answers->Find(mp) : nullptr;
+        if (!entry && !searchanswers)
+            return;
+        res.hasoptimum = true;
+        res.optimum = entry ? entry->answer : mp.Solution();
+        if (session)
+            session->ExpectAnswer(res.optimum);
+    }
+};
+
+// The value of the line "key:value" after "Stats:" in the output of the
+// interactor, "" if there is none
+string StatsField(const string& output, const string& key)
+{
+    size_t stats = output.find("Stats:");
+    if (stats == string::npos)
+        return "";
+    size_t pos = output.find('\n' + key + ':', stats);
+    if (pos == string::npos)
+        return "";
+    pos += key.size() + 2;
+    return output.substr(pos, output.find('\n', pos) - pos);
+}
+
+TestResult RunTest(const TestSetup& setup, const Corpus& tests, size_t index)
+{
+    TestResult res;
+    vector<string> args{"invoker", "-stats"};
+    if (setup.binary)
+        args.push_back("-binary");
+    // A map that shares its file is picked by where it starts in a text file,
+    // so that the interactor does not scan the whole file, and by its index
+    // in a packed one
+    string testfile = tests.File(index);
+    if (testfile.empty())
+    {
+        long long offset = tests.Offset(index);
+        if (offset != -1)
+            args.insert(args.end(), {"-offset", to_string(offset)});
         else
+            args.insert(args.end(), {"-index", to_string(index)});
+        testfile = tests.Path();
+    }
+    if (setup.answers)
+        args.insert(args.end(), {"-answers", setup.answersfile});
+    if (setup.UsesAnswers())
+        setup.UseAnswer(*tests.Load(index), nullptr, res);
+    args.insert(args.end(), {setup.progfile, testfile, setup.variant});
+    // The interactor and the solver it starts share a process group, so the
+    // timeout kills both
+    Process invoker(setup.invokerfile, args, {}, setup.limits);
+    invoker.SetTimeout(setup.timeoutms);
+    auto start = chrono::steady_clock::now();
+    string output;
+    FILE* outp = invoker.StdOUT();
+    char buf[128];
+    while (fgets(buf, 128, outp))
+        output += buf;
+    int status = invoker.Wait();
+    auto end = chrono::steady_clock::now();
+    res.passed = status == 0;
+    res.killed = invoker.KillReason(status);
+    if (res.killed.empty())
+        res.killed = StatsField(output, "killed");
+    if (output.find("Stats:") == string::npos)
+        res.time =
+            chrono::duration_cast<chrono::microseconds>(end - start).count();
+    else
+    {
+        res.time = atoll(StatsField(output, "time_us").c_str());
+        res.moves = atoll(StatsField(output, "moves").c_str());
+        res.hasusage = true;
+        res.usage.usertime = atoll(StatsField(output, "user_us").c_str());
+        res.usage.systime = atoll(StatsField(output, "sys_us").c_str());
+        res.usage.maxrss = atoll(StatsField(output, "maxrss_kb").c_str());
+        res.usage.voluntaryswitches =
+            atoll(StatsField(output, "vcsw").c_str());
+        res.usage.involuntaryswitches =
+            atoll(StatsField(output, "ivcsw").c_str());
+        res.counters =
+            InteractorSession::ParseCounters(StatsField(output, "counters"));
+    }
+    return res;
+}
+
+// Run the test without the interactor, talking to the solver directly
+TestResult RunTestDirect(const TestSetup& setup, const Corpus& tests,
+                         size_t index)
+{
+    TestResult res;
+    auto mp = tests.Load(index);
+    Process child(setup.progfile, setup.SolverArgs(), {}, setup.limits);
+    child.SetTimeout(setup.timeoutms);
+    InteractorSession session(*mp, stoi(setup.variant));
+    setup.UseAnswer(*mp, &session, res);
+    auto start = chrono::steady_clock::now();
+    res.passed = session.Run(child.StdOUT(), child.StdIN());
+    res.killed = child.KillReason(res.passed ? child.Wait(&res.usage)
+                                             : child.Kill(50, &res.usage));
+    res.hasusage = true;
+    auto end = chrono::steady_clock::now();
+    res.time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+    res.moves = session.Moves();
+    res.counters = session.Counters();
+    return res;
+}
+
+// Run the test on a solver process that stays alive between tests (started
+// with -batch). A fresh process is started if there is none or the previous
+// test has failed
+TestResult RunTestPersistent(const TestSetup& setup, unique_ptr<Process>& child,
+                             const Corpus& tests, size_t index)
+{
+    TestResult res;
+    auto mp = tests.Load(index);
+    if (!child)
+        child = make_unique<Process>(setup.progfile, setup.SolverArgs(),
+                                     vector<string>{}, setup.limits);
+    InteractorSession session(*mp, stoi(setup.variant));
+    setup.UseAnswer(*mp, &session, res);
+    child->SetTimeout(setup.timeoutms);
+    auto start = chrono::steady_clock::now();
+    res.passed = session.Run(child->StdOUT(), child->StdIN());
+    auto end = chrono::steady_clock::now();
+    child->SetTimeout(0);
+    if (!res.passed)
+    {
+        res.killed = child->KillReason(child->Kill(50, &res.usage));
+        res.processended = true;
+        child.reset();
+    }
+    res.time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+    res.moves = session.Moves();
+    res.counters = session.Counters();
+    return res;
+}
+
+// Writes a record of every test as soon as its result is known, so that runs
+// can be compared over time without keeping the results in memory
+class ResultWriter
+{
+public:
+    enum class Format
+    {
+        None,
+        JsonLines, // One JSON object per line
+        Csv        // A header, then one row per test
+    };
+
+private:
+    Format format;
+    ostream& out;
+
+    static string JsonString(const string& s)
+    {
+        string res = "\"";
+        for (char c : s)
         {
-            if (maxrun < run)
+            if (c == '"' || c == '\\')
+                res += '\\';
+            if ((unsigned char)c < 0x20)
             {
-                maxrun = run;
-                mode = i;
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                res += buf;
             }
-            prev = i;
-            run = 1;
+            else
+                res += c;
         }
+        return res + '"';
     }
-    if (maxrun < run)
+    static string CsvString(const string& s)
     {
-        maxrun = run;
-        mode = prev;
+        if (s.find_first_of(",\"\r\n") == string::npos)
+            return s;
+        string res = "\"";
+        for (char c : s)
+            res += c == '"' ? "\"\"" : string(1, c);
+        return res + '"';
     }
-    stream << "Mode: " << mode << " (" << maxrun << " occurrences)\n";
-    stream << "Median: ";
-    if (n & 1)
-        stream << vals[vals.size() / 2];
-    else
+
+public:
+    ResultWriter(Format format, ostream& out) : format(format), out(out)
+    {
+        if (format == Format::Csv)
+            out << "index,path,program,variant,verdict,moves,time_us,cpu_us,"
+                << "answer\n";
+    }
+
+    // Parse the name of a format, returns false if it is unknown
+    static bool ParseFormat(const string& name, Format& format)
+    {
+        if (name == "jsonl")
+            format = Format::JsonLines;
+        else if (name == "csv")
+            format = Format::Csv;
+        else
+            return false;
+        return true;
+    }
+
+    // The CPU time is empty (null in JSON) if unknown: the persistent mode
+    // cannot measure the CPU time of a single test. The answer is from the
+    // answer index, or found by a search if the map is not in one
+    void Write(size_t index, const string& path, const string& program,
+               const string& variant, const TestResult& res)
+    {
+        string cpu = res.hasusage
+                         ? to_string(res.usage.usertime + res.usage.systime)
+                         : "";
+        string answer = res.hasoptimum ? to_string(res.optimum) : "";
+        if (format == Format::JsonLines)
+            out << "{\"index\":" << index << ",\"path\":" << JsonString(path)
+                << ",\"program\":" << JsonString(program)
+                << ",\"variant\":" << JsonString(variant) << ",\"verdict\":\""
+                << res.Verdict() << "\",\"moves\":" << res.moves
+                << ",\"time_us\":" << res.time
+                << ",\"cpu_us\":" << (cpu.empty() ? "null" : cpu)
+                << ",\"answer\":" << (answer.empty() ? "null" : answer)
+                << "}\n";
+        else if (format == Format::Csv)
+            out << index << ',' << CsvString(path) << ','
+                << CsvString(program) << ',' << CsvString(variant) << ','
+                << res.Verdict() << ',' << res.moves << ',' << res.time << ','
+                << cpu << ',' << answer << '\n';
+    }
+};
+
+// The statistics of the tests run by a worker, merged with those of the other
+// workers at the end
+struct RunStats
+{
+    Statistics times, moves;
+    // The moves beyond the length of the shortest path, the walk of a solver
+    // that knew the whole map, on the solvable tests passed. A solver may
+    // also answer before reaching the Keymaker and make fewer moves
+    Statistics excess;
+    // The resources of the solver, per test or, in the persistent mode, per
+    // process
+    Statistics user, sys, rss, vcsw, ivcsw;
+    // The counters of the solver per test, by name
+    map<string, Statistics> counters;
+    long long passed = 0, timelimit = 0, killed = 0;
+
+    void AddUsage(const ResourceUsage& usage)
+    {
+        user.Add(usage.usertime);
+        sys.Add(usage.systime);
+        rss.Add(usage.maxrss);
+        vcsw.Add(usage.voluntaryswitches);
+        ivcsw.Add(usage.involuntaryswitches);
+    }
+    void Add(const TestResult& res)
+    {
+        passed += res.passed;
+        timelimit += res.time > (int)1e6;
+        killed += !res.killed.empty();
+        times.Add(res.time);
+        moves.Add(res.moves);
+        if (res.passed && res.optimum > 0)
+            excess.Add(res.moves - res.optimum);
+        if (res.hasusage || res.processended)
+            AddUsage(res.usage);
+        for (auto& [name, value] : res.counters)
+            counters[name].Add(value);
+    }
+    void Merge(const RunStats& other)
     {
-        long long sm = vals[vals.size() / 2 - 1] + vals[vals.size() / 2];
-        if (sm & 1)
+        for (auto [stats, others] : {pair{&times, &other.times},
+                                     {&moves, &other.moves},
+                                     {&excess, &other.excess},
+                                     {&user, &other.user},
+                                     {&sys, &other.sys},
+                                     {&rss, &other.rss},
+                                     {&vcsw, &other.vcsw},
+                                     {&ivcsw, &other.ivcsw}})
+            stats->Merge(*others);
+        for (auto& [name, stats] : other.counters)
+            counters[name].Merge(stats);
+        passed += other.passed;
+        timelimit += other.timelimit;
+        killed += other.killed;
+    }
+    void Print(const TestSetup& setup, ostream& log) const
+    {
+        log << "Execution time, in microseconds:\n";
+        times.Print(log);
+        log << "Number of moves:\n";
+        moves.Print(log);
+        if (user.Count())
         {
-            stream.precision(1);
-            stream << sm / 2.0;
-            stream.precision(8);
+            if (setup.persistent)
+                log << "Resources of the " << user.Count()
+                    << " solver processes, for all their tests:\n";
+            else
+                log << "Resources of the solver:\n";
+            log << "User CPU time, in microseconds:\n";
+            user.Print(log);
+            log << "System CPU time, in microseconds:\n";
+            sys.Print(log);
+            log << "Peak resident memory, in kilobytes:\n";
+            rss.Print(log);
+            log << "Voluntary context switches:\n";
+            vcsw.Print(log);
+            log << "Involuntary context switches:\n";
+            ivcsw.Print(log);
         }
-        else
-            stream << sm / 2;
-    }
-    stream << '\n';
-    double sd = 0;
-    for (auto i : vals)
-        sd += (i - mean) * (i - mean);
-    sd = sqrt(sd / n);
-    cout << "Standard deviation: " << sd << endl;
-}
+        if (!counters.empty())
+        {
+            log << "Solver counters, per test: mean, median, 99th percentile "
+                << "and max:\n";
+            for (auto& [name, stats] : counters)
+                log << name << ": " << stats.Mean() << ", "
+                    << stats.Percentile(0.5) << ", " << stats.Percentile(0.99)
+                    << ", " << stats.Max() << '\n';
+        }
+        if (setup.answers && excess.Count())
+        {
+            log << "Moves beyond the shortest path, on " << excess.Count()
+                << " solvable tests:\n";
+            excess.Print(log);
+        }
+        long long count = times.Count();
+        log << "\nPassed tests: " << passed << "/" << count << endl;
+        log << "Time limit exceeded on " << timelimit << "/" << count << endl;
+        log << "Killed by a limit or a signal on " << killed << "/" << count
+            << endl;
+    }
+};
 
-int main(int argc, char** argv)
+// The differences between two solvers run on the same tests, the second
+// minus the first, on the tests that both pass
+struct Comparison
 {
-    if (argc != 5)
+    Statistics moves, times;
+    long long fewermoves = 0, moremoves = 0, faster = 0, slower = 0;
+    long long onlyfirst = 0, onlysecond = 0; // The tests passed by one only
+
+    void Add(const TestResult& first, const TestResult& second)
+    {
+        onlyfirst += first.passed && !second.passed;
+        onlysecond += !first.passed && second.passed;
+        if (!first.passed || !second.passed)
+            return;
+        moves.Add(second.moves - first.moves);
+        times.Add(second.time - first.time);
+        fewermoves += second.moves < first.moves;
+        moremoves += second.moves > first.moves;
+        faster += second.time < first.time;
+        slower += second.time > first.time;
+    }
+    // The mean difference and the sign test of one quantity
+    static void PrintTest(const Statistics& diffs, long long better,
+                          long long worse, const char* fewer,
+                          const char* more, ostream& log)
+    {
+        double p = SignTest(better, worse);
+        log << "Mean difference: " << diffs.Mean() << " +- "
+            << diffs.MeanError() << " (95% confidence)\n"
+            << fewer << " on " << better << " tests, " << more << " on "
+            << worse << ": sign test p = " << p
+            << (p < 0.05 ? ", significant" : ", not significant")
+            << " at 5%\n";
+    }
+    void Print(const string& first, const string& second, ostream& log) const
+    {
+        log << "\n--Comparison of " << second << " with " << first << ", on "
+            << moves.Count() << " tests passed by both--\n";
+        if (moves.Count())
+        {
+            log << "Moves, " << second << " minus " << first << ":\n";
+            moves.Print(log);
+            PrintTest(moves, fewermoves, moremoves, "Fewer moves", "more",
+                      log);
+            log << "Execution time in microseconds, " << second << " minus "
+                << first << ":\n";
+            times.Print(log);
+            PrintTest(times, faster, slower, "Faster", "slower", log);
+        }
+        log << "Passed by " << first << " only: " << onlyfirst << ", by "
+            << second << " only: " << onlysecond << endl;
+    }
+};
+
+// Run the tests given on the command line
+int Run(int argc, char** argv)
+{
+    // A solver that exits in the middle of a test fails the test, instead of
+    // killing the tester when it writes to the solver
+    signal(SIGPIPE, SIG_IGN);
+    int jobs = 1;
+    long long onlyindex = -1;
+    int shard = 0, shards = 1;
+    TestSetup setup;
+    bool compare = false;
+    auto format = ResultWriter::Format::None;
+    int argsstart = 1;
+    for (; argsstart < argc && argv[argsstart][0] == '-'; argsstart++)
+    {
+        if (strcmp(argv[argsstart], "-j") == 0 && argsstart + 1 < argc)
+            jobs = max(1, atoi(argv[++argsstart]));
+        else if (strcmp(argv[argsstart], "-direct") == 0)
+            setup.direct = true;
+        else if (strcmp(argv[argsstart], "-persistent") == 0)
+            setup.direct = setup.persistent = true;
+        else if (strcmp(argv[argsstart], "-binary") == 0)
+            setup.binary = true;
+        else if (strcmp(argv[argsstart], "-compare") == 0 ||
+                 strcmp(argv[argsstart], "--compare") == 0)
+            compare = true;
+        else if (strcmp(argv[argsstart], "-index") == 0 && argsstart + 1 < argc)
+            onlyindex = atoll(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-shard") == 0 && argsstart + 1 < argc)
+        {
+            // Nothing may follow N
+            char rest;
+            if (sscanf(argv[++argsstart], "%d/%d%c", &shard, &shards,
+                       &rest) != 2 ||
+                shard < 0 || shard >= shards)
+            {
+                cout << "Bad shard " << argv[argsstart]
+                     << ": -shard K/N needs 0 <= K < N" << endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argsstart], "-answers") == 0 &&
+                 argsstart + 1 < argc)
+        {
+            setup.answersfile = argv[++argsstart];
+            setup.answers = make_shared<AnswerIndex>(setup.answersfile);
+        }
+        else if (strcmp(argv[argsstart], "-timeout") == 0 &&
+                 argsstart + 1 < argc)
+            setup.timeoutms = atoll(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-cpu") == 0 && argsstart + 1 < argc)
+            setup.limits.cpuseconds = atoi(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-memory") == 0 &&
+                 argsstart + 1 < argc)
+            setup.limits.memorybytes = atoll(argv[++argsstart]) << 20;
+        else if (strncmp(argv[argsstart], "--format=", 9) == 0 ||
+                 (strcmp(argv[argsstart], "-format") == 0 &&
+                  argsstart + 1 < argc))
+        {
+            const char* name = argv[argsstart][1] == '-' ? argv[argsstart] + 9
+                                                         : argv[++argsstart];
+            if (!ResultWriter::ParseFormat(name, format))
+            {
+                cout << "Unknown format " << name << endl;
+                return 1;
+            }
+        }
+    }
+    if (argc - argsstart != (setup.direct ? 3 : 4) + compare)
     {
-        cout << "Usage: tester program.bin variant interactor.bin "
-             << "path/of/tests/directory" << endl;
+        cout << "Usage: tester [-j N] [-binary] [-index I] [-shard K/N] "
+             << "program.bin variant interactor.bin path/of/tests\n"
+             << "       tester [-j N] [-binary] [-index I] [-shard K/N] "
+             << "-direct|-persistent program.bin variant path/of/tests\n"
+             << "       tester [options] -compare a.bin b.bin variant "
+             << "[interactor.bin] path/of/tests\n"
+             << "The tests are a directory of map files, a file of maps or a "
+             << "packed corpus.\n-index runs only the test I, -shard only "
+             << "the tests whose index is K modulo N.\n-answers "
+             << "answers.bin checks the answers against an index written by "
+             << "oracle.bin, and compares the moves with the shortest paths.\n"
+             << "-timeout MS kills a test after MS milliseconds (10000 by "
+             << "default, 0 for never); -cpu S and -memory MB limit the CPU "
+             << "time and the address space of the processes.\n"
+             << "-format jsonl|csv (or --format=...) writes a record of every "
+             << "test, with its answer from -answers or a search of the map, "
+             << "to the standard output as soon as it ends, and the "
+             << "report to the standard error.\n-compare runs both programs "
+             << "on every test, in alternating order, and tests the "
+             << "differences in moves and time" << endl;
         return 0;
     }
-    string progfile = argv[1];
-    string variant = argv[2];
-    string invokerfile = argv[3];
-    string dir = argv[4];
-    long long testcount = 0;
-    vector<long long> times, moves;
-    int passedtests = 0;
-    int tlecount = 0;
-    for (auto& entry : filesystem::directory_iterator(dir))
-    {
-        testcount++;
-        long long &time = times.emplace_back(),
-                  &movecount = moves.emplace_back();
-        Process invoker(invokerfile,
-                        {"invoker", "-stats", progfile, entry.path(), variant},
-                        {});
-        stringstream stats;
-        FILE* outp = invoker.StdOUT();
-        char buf[128];
-        while (fgets(buf, 128, outp))
-            stats << buf;
-        int result = invoker.Wait();
-        if (result != 0)
-            cout << "Failure on " << entry.path() << "!" << endl;
-        else
-            passedtests++;
-        string sstats = stats.str();
-        int cur = sstats.find("Stats:");
-        cur = sstats.find(':', cur + 6);
-        stats.seekg(cur + 1);
-        stats >> time;
-        cur = sstats.find(':', cur + 1);
-        stats.seekg(cur + 1);
-        stats >> movecount;
-        if (time > (int)1e6)
+    // The setups of the programs, the same but for the program file
+    // The records have the answer of every test
+    setup.searchanswers = format != ResultWriter::Format::None;
+    vector<TestSetup> setups(1 + compare, setup);
+    for (size_t i = 0; i < setups.size(); i++)
+        setups[i].progfile = argv[argsstart + i];
+    argsstart += compare;
+    for (auto& setup : setups)
+    {
+        setup.variant = argv[argsstart + 1];
+        if (!setup.direct)
+            setup.invokerfile = argv[argsstart + 2];
+    }
+    Corpus tests(argv[argsstart + (setup.direct ? 2 : 3)]);
+    vector<size_t> selected;
+    for (size_t i = 0; i < tests.Size(); i++)
+        if (onlyindex == -1 ? (long long)i % shards == shard
+                            : (long long)i == onlyindex)
+            selected.push_back(i);
+    long long testcount = selected.size();
+    int programs = setups.size();
+
+    // The workers take tests from the queue in order; the results are
+    // reported in the same order, no matter which worker finishes first. Only
+    // the results that are not reported yet are kept
+    map<long long, vector<TestResult>> finished;
+    atomic<long long> nexttest = 0;
+    mutex donemutex;
+    condition_variable donecv;
+    // stats[i][p] = the statistics of the program p on the tests of worker i
+    vector<vector<RunStats>> stats(jobs, vector<RunStats>(programs));
+    vector<thread> workers;
+    for (int i = 0; i < jobs; i++)
+        workers.emplace_back([&, i]() {
+            // Used only in the persistent mode
+            vector<unique_ptr<Process>> children(programs);
+            long long index;
+            while ((index = nexttest++) < testcount)
+            {
+                size_t test = selected[index];
+                vector<TestResult> res(programs);
+                // Alternate which program runs first, so that a drift of the
+                // speed of the machine affects both alike
+                for (int k = 0; k < programs; k++)
+                {
+                    int p = (k + index) % programs;
+                    const TestSetup& setup = setups[p];
+                    // A test that cannot be run, say because no process can
+                    // be started, fails without stopping the others
+                    try
+                    {
+                        res[p] =
+                            setup.persistent
+                                ? RunTestPersistent(setup, children[p], tests,
+                                                    test)
+                            : setup.direct ? RunTestDirect(setup, tests, test)
+                                           : RunTest(setup, tests, test);
+                    }
+                    catch (const exception& e)
+                    {
+                        res[p] = TestResult();
+                        res[p].error = e.what();
+                    }
+                    stats[i][p].Add(res[p]);
+                }
+                lock_guard<mutex> lock(donemutex);
+                finished.emplace(index, move(res));
+                donecv.notify_one();
+            }
+            for (int p = 0; p < programs; p++)
+                if (children[p])
+                {
+                    ResourceUsage usage;
+                    children[p]->Wait(&usage);
+                    stats[i][p].AddUsage(usage);
+                }
+        });
+
+    // With a format, the records take the standard output
+    ostream& log = format == ResultWriter::Format::None ? cout : cerr;
+    ResultWriter writer(format, cout);
+    Comparison comparison;
+    for (long long i = 0; i < testcount; i++)
+    {
+        vector<TestResult> res;
         {
-            cout << "Time limit exceeded on " << entry.path() << endl;
-            tlecount++;
+            unique_lock<mutex> lock(donemutex);
+            donecv.wait(lock, [&]() { return finished.count(i) > 0; });
+            auto it = finished.find(i);
+            res = move(it->second);
+            finished.erase(it);
         }
-        if (testcount % 100 == 0)
-            cout << "Tested on " << testcount << " examples." << endl;
-    }
-    cout << "Ran " << testcount << " tests.\n\n--Final Statistics--\n";
-    cout << "Execution time, in microseconds:\n";
-    PrintStats(times, cout);
-    cout << "Number of moves:\n";
-    PrintStats(moves, cout);
-    cout << "\nPassed tests: " << passedtests << "/" << testcount << endl;
-    cout << "Time limit exceeded on " << tlecount << "/" << testcount << endl;
+        string path = tests.Name(selected[i]);
+        for (int p = 0; p < programs; p++)
+        {
+            // Name the program only when there are two
+            string by = compare ? " by " + setups[p].progfile : "";
+            if (!res[p].killed.empty())
+                log << "Killed" << by << " on \"" << path << "\" (-index "
+                    << selected[i] << "): " << res[p].killed << endl;
+            else if (!res[p].passed)
+                log << "Failure" << by << " on \"" << path << "\" (-index "
+                    << selected[i] << ")"
+                    << (res[p].error.empty() ? "!" : ": " + res[p].error)
+                    << endl;
+            if (res[p].time > (int)1e6)
+                log << "Time limit exceeded" << by << " on \"" << path << '"'
+                    << endl;
+            writer.Write(selected[i], path, setups[p].progfile,
+                         setups[p].variant, res[p]);
+        }
+        if (compare)
+        {
+            comparison.Add(res[0], res[1]);
+            // A regression of either program: it fails where the other
+            // passes, or it makes more moves
+            for (int p = 0; p < 2; p++)
+            {
+                const TestResult &mine = res[p], &other = res[1 - p];
+                if (other.passed &&
+                    (!mine.passed || mine.moves > other.moves))
+                    log << "Regression of " << setups[p].progfile << " on \""
+                        << path << "\" (-index " << selected[i] << "): "
+                        << (mine.passed ? to_string(mine.moves) + " moves"
+                                        : string(mine.Verdict()))
+                        << " against " << other.moves << " moves" << endl;
+            }
+        }
+        if ((i + 1) % 100 == 0)
+            log << "Tested on " << i + 1 << " examples." << endl;
+    }
+    for (auto& worker : workers)
+        worker.join();
+    log << "Ran " << testcount << " tests.\n";
+    for (int p = 0; p < programs; p++)
+    {
+        for (int i = 1; i < jobs; i++)
+            stats[0][p].Merge(stats[i][p]);
+        log << "\n--Final Statistics";
+        if (compare)
+            log << " of " << setups[p].progfile;
+        log << "--\n";
+        stats[0][p].Print(setups[p], log);
+    }
+    if (compare)
+        comparison.Print(setups[0].progfile, setups[1].progfile, log);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    return RunReporting(Run, argc, argv);
 }
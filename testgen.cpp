@@ -1,29 +1,67 @@
 #include "interactorMap.h"
-#include <climits>
-#include <cstdio>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <random>
 #include <sstream>
+#include <thread>
 using namespace std;
 
-FILE* randgen;
-
-int randint()
+// The xoshiro256** generator. Every candidate map has its own stream, derived
+// from the seed of the corpus and the number of the candidate, so a corpus
+// depends only on the seed, whatever the number of threads
+class Random
 {
-    int res;
-    fread(&res, sizeof(int), 1, randgen);
-    res &= INT_MAX;
-    return res;
-}
+    uint64_t s[4];
 
-int randint(int n)
-{
-    return randint() % n;
-}
+    static uint64_t SplitMix(uint64_t& x)
+    {
+        uint64_t z = x += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ z >> 27) * 0x94D049BB133111EBULL;
+        return z ^ z >> 31;
+    }
+    static uint64_t Rotl(uint64_t x, int k)
+    {
+        return x << k | x >> (64 - k);
+    }
 
-int randint(int min, int exmax)
-{
-    return randint(exmax - min) + min;
-}
+public:
+    Random(uint64_t seed, uint64_t stream)
+    {
+        uint64_t x = seed;
+        x ^= SplitMix(stream);
+        for (auto& word : s)
+            word = SplitMix(x);
+    }
+
+    uint64_t Next()
+    {
+        uint64_t res = Rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return res;
+    }
+    // A number in [0, n)
+    int Below(int n)
+    {
+        return (Next() >> 32) * n >> 32;
+    }
+    // A number in [min, exmax)
+    int Between(int min, int exmax)
+    {
+        return Below(exmax - min) + min;
+    }
+};
 
 template <class T> void quickremove(vector<T>& v, int index)
 {
@@ -31,87 +69,194 @@ template <class T> void quickremove(vector<T>& v, int index)
     v.pop_back();
 }
 
-void RenderMap(stringstream& output, string* ans)
+// The size of the generated maps
+int width = 9, height = 9;
+
+void RenderMap(stringstream& output, const vector<string>& ans)
 {
-    for (int i = 0; i < 9; i++)
+    // 9 by 9 maps have no header
+    if (width != 9 || height != 9)
+        output << "size " << width << ' ' << height;
+    for (int i = 0; i < height; i++)
         output << '\n' << ans[i];
+    // So that map files can be concatenated
+    output << '\n';
 }
 
-stringstream GenerateTestcase()
+string GenerateTestcase(Random& rng)
 {
-    int nobstacles = randint(3, 12);
-    vector<pair<int, int>> allcoords(81);
-    for (int i = 0; i < 9; i++)
-        for (int j = 0; j < 9; j++)
-            allcoords[i * 9 + j] = {i, j};
-    quickremove(allcoords, 0);
-    vector<pair<int, int>> chosen(nobstacles);
-    for (int i = 0; i < nobstacles; i++)
+    int cells = width * height;
+    vector<pair<int, int>> allcoords;
+    vector<string> ans;
+    unique_ptr<Map> proto;
+    // Draw obstacles until the start is safe
+    do
     {
-        chosen[i] = allcoords[randint(allcoords.size())];
-        quickremove(allcoords, i);
-    }
-    string ans[9];
-    for (string& s : ans)
-        s.assign(9, '.');
-    for (auto& p : chosen)
-        ans[p.second][p.first] = randint(2) ? 'A' : 'S';
-    stringstream ss;
-    RenderMap(ss, ans);
-    Map proto(ss);
-    ss.seekg(0);
-    ss.seekp(0);
-    if (!proto.CellIsSafe(0, 0))
-        return GenerateTestcase();
+        // 3 to 11 obstacles per 81 cells
+        int nobstacles = rng.Between(3 * cells / 81, 12 * cells / 81);
+        allcoords.resize(cells);
+        for (int i = 0; i < width; i++)
+            for (int j = 0; j < height; j++)
+                allcoords[i * height + j] = {i, j};
+        quickremove(allcoords, 0);
+        // As the generator always has, remove the i-th candidate rather than
+        // the one drawn: a cell may be drawn twice, and the maps keep the
+        // distribution of the existing tests
+        vector<pair<int, int>> chosen(nobstacles);
+        for (int i = 0; i < nobstacles; i++)
+        {
+            chosen[i] = allcoords[rng.Below(allcoords.size())];
+            quickremove(allcoords, i);
+        }
+        ans.assign(height, string(width, '.'));
+        for (auto& p : chosen)
+            ans[p.second][p.first] = rng.Below(2) ? 'A' : 'S';
+        stringstream ss;
+        RenderMap(ss, ans);
+        proto = Map::Read(ss);
+    } while (!proto->CellIsSafe(0, 0));
     for (int i = (int)allcoords.size() - 1; i >= 0; i--)
     {
         pair<int, int> coords = allcoords[i];
-        if (!proto.CellIsSafe(coords.first, coords.second))
+        if (!proto->CellIsSafe(coords.first, coords.second))
             quickremove(allcoords, i);
     }
-    int index = randint(allcoords.size());
+    int index = rng.Below(allcoords.size());
     pair<int, int> key = allcoords[index];
     quickremove(allcoords, index);
-    pair<int, int> keymaker = allcoords[randint(allcoords.size())];
+    pair<int, int> keymaker = allcoords[rng.Below(allcoords.size())];
     ans[key.second][key.first] = 'B';
     ans[keymaker.second][keymaker.first] = 'K';
+    stringstream ss;
     RenderMap(ss, ans);
-    return ss;
+    return ss.str();
 }
 
-int main(int argc, char** argv)
+// Pack the text maps in the directory into a corpus, named as their files
+int ConvertDirectory(const string& dir, const string& corpusfile)
 {
-    randgen = fopen("/dev/random", "r");
+    vector<pair<string, unique_ptr<Map>>> maps;
+    for (auto& entry : filesystem::directory_iterator(dir))
+    {
+        ifstream fs(entry.path());
+        maps.emplace_back(entry.path().filename(), Map::Read(fs));
+        if (maps.back().second->Width() != maps[0].second->Width() ||
+            maps.back().second->Height() != maps[0].second->Height())
+        {
+            cout << "The maps of a corpus must have the same size" << endl;
+            return 1;
+        }
+    }
+    CorpusWriter writer(maps.empty() ? 9 : maps[0].second->Width(),
+                        maps.empty() ? 9 : maps[0].second->Height(),
+                        maps.size());
+    for (size_t i = 0; i < maps.size(); i++)
+        writer.Set(i, maps[i].first, *maps[i].second);
+    ofstream fs(corpusfile, ios::binary);
+    writer.Write(fs);
+    cout << "Packed " << maps.size() << " testcases" << endl;
+    return 0;
+}
 
-    if (argc < 5)
+int main(int argc, char** argv)
+{
+    uint64_t seed = (uint64_t)random_device()() << 32 | random_device()();
+    int jobs = 1;
+    bool pack = false, convert = false;
+    int argsstart = 1;
+    for (; argsstart < argc && argv[argsstart][0] == '-'; argsstart++)
     {
-        cout << "Usage: testgen #solvable #unsolvable "
-             << "startindex prefix/of/files" << endl;
+        if (strcmp(argv[argsstart], "-size") == 0 && argsstart + 1 < argc)
+            width = height = atoi(argv[++argsstart]);
+        else if (strcmp(argv[argsstart], "-seed") == 0 && argsstart + 1 < argc)
+            seed = strtoull(argv[++argsstart], nullptr, 10);
+        else if (strcmp(argv[argsstart], "-j") == 0 && argsstart + 1 < argc)
+            jobs = max(atoi(argv[++argsstart]), 1);
+        else if (strcmp(argv[argsstart], "-pack") == 0)
+            pack = true;
+        else if (strcmp(argv[argsstart], "-convert") == 0)
+            convert = true;
+    }
+    if (convert && argc - argsstart == 2)
+        return ConvertDirectory(argv[argsstart], argv[argsstart + 1]);
+    if (convert || argc - argsstart < 4)
+    {
+        cout << "Usage: testgen [-size N] [-seed S] [-j N] [-pack] "
+             << "#solvable #unsolvable startindex prefix/of/files\n"
+             << "       testgen -convert path/of/tests/directory corpus.bin"
+             << endl;
+        cout << "The maps are N by N, 9 by 9 by default. The same seed "
+             << "generates the same maps\n"
+             << "With -pack, the maps are written into the corpus file "
+             << "prefix/of/files as test<index>; -convert packs the map "
+             << "files of a directory" << endl;
         return 0;
     }
 
-    int needsol = atoi(argv[1]);
-    int needunsol = atoi(argv[2]);
-    int startindex = atoi(argv[3]);
-    string fileprefix = argv[4];
+    int needsol = atoi(argv[argsstart]);
+    int needunsol = atoi(argv[argsstart + 1]);
+    int startindex = atoi(argv[argsstart + 2]);
+    string fileprefix = argv[argsstart + 3];
+    unique_ptr<CorpusWriter> writer;
+    if (pack)
+        writer = make_unique<CorpusWriter>(width, height, needsol + needunsol);
 
+    // The workers take candidates in order and generate them in parallel;
+    // the candidates are then accepted or rejected in order, so the quotas
+    // are filled by the same maps no matter which worker finishes first
+    atomic<long long> nextcandidate = 0;
+    // Guarded by decidedmutex
     int qsolvable = needsol, qunsolvable = needunsol;
+    long long decided = 0;
     int curindex = startindex;
-    while (qsolvable + qunsolvable)
+    mutex decidedmutex;
+    condition_variable decidedcv;
+    vector<thread> workers;
+    for (int i = 0; i < jobs; i++)
+        workers.emplace_back([&]() {
+            for (bool filled = false; !filled;)
+            {
+                long long candidate = nextcandidate++;
+                Random rng(seed, candidate);
+                string text = GenerateTestcase(rng);
+                stringstream ss(text);
+                auto mp = Map::Read(ss);
+                bool solv = mp->Solution() != -1;
+
+                int index = -1;
+                {
+                    unique_lock<mutex> lock(decidedmutex);
+                    decidedcv.wait(lock,
+                                   [&]() { return decided == candidate; });
+                    int& quota = solv ? qsolvable : qunsolvable;
+                    if (quota)
+                    {
+                        quota--;
+                        index = curindex++;
+                    }
+                    filled = qsolvable + qunsolvable == 0;
+                    decided++;
+                }
+                decidedcv.notify_all();
+                if (index == -1)
+                    continue;
+                if (writer)
+                {
+                    writer->Set(index - startindex, "test" + to_string(index),
+                                *mp);
+                    continue;
+                }
+                ofstream fs(fileprefix + to_string(index), ios::out);
+                fs << text;
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+    if (writer)
     {
-        auto ss = GenerateTestcase();
-        Map mp(ss);
-        ss.seekg(0);
-        bool solv = mp.Solution() != -1;
-        int& quota = solv ? qsolvable : qunsolvable;
-        if (!quota)
-            continue;
-        quota--;
-        string filename = fileprefix + to_string(curindex++);
-        ofstream fs(filename, ios::out);
-        fs << ss.rdbuf();
+        ofstream fs(fileprefix, ios::binary);
+        writer->Write(fs);
     }
-    cout << "Generated " << needsol + needunsol << " testcases" << endl;
-
-    fclose(randgen);
+    cout << "Generated " << needsol + needunsol << " testcases with seed "
+         << seed << endl;
 }